@@ -0,0 +1,414 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/stat.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+#include "cnef.h"
+
+using namespace std;
+
+#define ANN_EXONS		0
+#define ANN_GENES		1
+#define ANN_VERSION		1
+
+static const char ann_magic[8] = { 'C', 'N', 'E', 'F', 'A', 'N', 'N', '\0' };
+
+/*
+Field f of the tab-separated line [p, end), without surrounding white space
+*/
+static string ann_field( const char * p, const char * end, int f )
+{
+	for( ; f > 0 && p < end; p++ )
+		if( *p == '\t' )
+			f--;
+
+	if( f > 0 )
+		return string();
+
+	const char * q = p;
+	while( q < end && *q != '\t' )
+		q++;
+
+	while( p < q && isspace( ( unsigned char ) *p ) )
+		p++;
+	while( q > p && isspace( ( unsigned char ) q[-1] ) )
+		q--;
+
+return string( p, q );
+}
+
+static bool ann_digits( const string & s )
+{
+	for( unsigned int k = 0; k < s.size(); k++ )
+		if( ! isdigit( ( unsigned char ) s[k] ) )
+			return false;
+
+return true;
+}
+
+static bool order_interval( const AnnInterval & a, const AnnInterval & b )
+{
+	return a.start < b.start;
+}
+
+/*
+Adds one upper-cased line. Exon lines are keyed by their first field, the
+chromosome, and give the start and end in the next two; gene lines are keyed by
+the gene name and give the chromosome, start and end. A line needs a tab after
+its key to be indexed, and the first line of a gene wins.
+*/
+static void ann_add_line( AnnIndex * idx, const char * p, const char * end )
+{
+	const char * tab = ( const char * ) memchr( p, '\t', end - p );
+
+	if( tab == NULL )
+		return;
+
+	string key( p, tab );
+
+	if( idx->kind == ANN_EXONS )
+	{
+		AnnChrom & c = idx->chroms[key];
+		string c1 = ann_field( p, end, 1 );
+		string c2 = ann_field( p, end, 2 );
+
+		if( ! ann_digits( c1 ) || ! ann_digits( c2 ) )
+		{
+			c.malformed = true;
+			return;
+		}
+
+		AnnInterval e = { ( unsigned int ) atoi( c1.c_str() ), ( unsigned int ) atoi( c2.c_str() ) };
+		c.exons.push_back( e );
+	}
+	else if( idx->genes.find( key ) == idx->genes.end() )
+	{
+		AnnGene & g = idx->genes[key];
+
+		g.chrom = ann_field( p, end, 1 );
+		g.start = atoi( ann_field( p, end, 2 ).c_str() );
+		g.end = atoi( ann_field( p, end, 3 ).c_str() );
+	}
+}
+
+/*
+Sorts the exons of every chromosome by start and notes the longest one
+*/
+static void ann_finish( AnnIndex * idx )
+{
+	for( auto it = idx->chroms.begin(); it != idx->chroms.end(); ++it )
+	{
+		AnnChrom & c = it->second;
+
+		stable_sort( c.exons.begin(), c.exons.end(), order_interval );
+		c.maxLen = 0;
+		for( unsigned int k = 0; k < c.exons.size(); k++ )
+			if( c.exons[k].end > c.exons[k].start )
+				c.maxLen = max( c.maxLen, c.exons[k].end - c.exons[k].start );
+	}
+}
+
+static int ann_parse( const char * filename, AnnIndex * idx )
+{
+	FILE * fd;
+
+	if ( ! ( fd = fopen ( filename, "r" ) ) )
+	{
+		fprintf ( stderr, " Error: Cannot open file %s!\n", filename );
+		return ( 1 );
+	}
+
+	vector<char> text;
+	char buf[1 << 16];
+	size_t n;
+
+	while( ( n = fread( buf, 1, sizeof( buf ), fd ) ) > 0 )
+		text.insert( text.end(), buf, buf + n );
+
+	if ( fclose ( fd ) )
+	{
+		fprintf( stderr, " Error: file close error!\n");
+		return ( 1 );
+	}
+
+	for( size_t k = 0; k < text.size(); k++ )
+		text[k] = toupper( ( unsigned char ) text[k] );
+
+	size_t from = 0;
+	while( from < text.size() )
+	{
+		char * nl = ( char * ) memchr( &text[from], '\n', text.size() - from );
+		size_t to = nl ? nl - text.data() : text.size();
+
+		if( to == from )
+			fprintf ( stderr, " Omitting empty line in file %s!\n", filename );
+		else
+			ann_add_line( idx, &text[from], &text[to] );
+
+		from = to + 1;
+	}
+
+	ann_finish( idx );
+
+return 0;
+}
+
+/*
+Sidecar file: the index of one annotation file, stamped with the size and
+modification time of that file, so that a later run can load it instead of
+parsing the text again
+*/
+static string ann_sidecar( const char * filename, int kind )
+{
+	return string( filename ) + ( kind == ANN_EXONS ? ".cnef-exons" : ".cnef-genes" );
+}
+
+static int ann_put( FILE * fd, const void * v, size_t n )
+{
+	return fwrite( v, 1, n, fd ) != n;
+}
+
+static int ann_get( FILE * fd, void * v, size_t n )
+{
+	return fread( v, 1, n, fd ) != n;
+}
+
+static int ann_put_string( FILE * fd, const string & s )
+{
+	uint32_t len = s.size();
+
+	return ann_put( fd, &len, sizeof( len ) ) || ann_put( fd, s.data(), len );
+}
+
+static int ann_get_string( FILE * fd, string * s )
+{
+	uint32_t len;
+
+	if( ann_get( fd, &len, sizeof( len ) ) || len > ( 1 << 20 ) )
+		return ( 1 );
+
+	s->resize( len );
+
+	return len && ann_get( fd, &( *s )[0], len );
+}
+
+static int ann_save( const string & sidecar, AnnIndex * idx, struct stat * st )
+{
+	FILE * fd;
+	uint32_t version = ANN_VERSION;
+	uint32_t kind = idx->kind;
+	uint64_t size = st->st_size;
+	int64_t mtime = st->st_mtime;
+	int err = 0;
+
+	if ( ! ( fd = fopen ( sidecar.c_str(), "wb" ) ) )
+		return ( 1 );
+
+	err |= ann_put( fd, ann_magic, sizeof( ann_magic ) ) || ann_put( fd, &version, sizeof( version ) ) || ann_put( fd, &kind, sizeof( kind ) );
+	err |= ann_put( fd, &size, sizeof( size ) ) || ann_put( fd, &mtime, sizeof( mtime ) );
+
+	if( idx->kind == ANN_EXONS )
+	{
+		uint64_t count = idx->chroms.size();
+		err |= ann_put( fd, &count, sizeof( count ) );
+
+		for( auto it = idx->chroms.begin(); it != idx->chroms.end() && ! err; ++it )
+		{
+			AnnChrom & c = it->second;
+			uint64_t exons = c.exons.size();
+			unsigned char malformed = c.malformed;
+
+			err |= ann_put_string( fd, it->first ) || ann_put( fd, &malformed, 1 ) || ann_put( fd, &c.maxLen, sizeof( c.maxLen ) );
+			err |= ann_put( fd, &exons, sizeof( exons ) ) || ( exons && ann_put( fd, c.exons.data(), exons * sizeof( AnnInterval ) ) );
+		}
+	}
+	else
+	{
+		uint64_t count = idx->genes.size();
+		err |= ann_put( fd, &count, sizeof( count ) );
+
+		for( auto it = idx->genes.begin(); it != idx->genes.end() && ! err; ++it )
+		{
+			AnnGene & g = it->second;
+			err |= ann_put_string( fd, it->first ) || ann_put_string( fd, g.chrom ) || ann_put( fd, &g.start, sizeof( g.start ) ) || ann_put( fd, &g.end, sizeof( g.end ) );
+		}
+	}
+
+	if( fclose( fd ) || err )
+	{
+		remove( sidecar.c_str() );
+		return ( 1 );
+	}
+
+return 0;
+}
+
+static int ann_load( const string & sidecar, AnnIndex * idx, struct stat * st )
+{
+	FILE * fd;
+	char magic[8];
+	uint32_t version, kind;
+	uint64_t size, count;
+	int64_t mtime;
+	int err = 0;
+
+	if ( ! ( fd = fopen ( sidecar.c_str(), "rb" ) ) )
+		return ( 1 );
+
+	err |= ann_get( fd, magic, sizeof( magic ) ) || memcmp( magic, ann_magic, sizeof( magic ) );
+	err |= err || ann_get( fd, &version, sizeof( version ) ) || ann_get( fd, &kind, sizeof( kind ) ) || version != ANN_VERSION || ( int ) kind != idx->kind;
+	err |= err || ann_get( fd, &size, sizeof( size ) ) || ann_get( fd, &mtime, sizeof( mtime ) ) || size != ( uint64_t ) st->st_size || mtime != ( int64_t ) st->st_mtime;
+	err |= err || ann_get( fd, &count, sizeof( count ) );
+
+	for( uint64_t k = 0; k < count && ! err; k++ )
+	{
+		string key;
+
+		if( ann_get_string( fd, &key ) )
+		{
+			err = 1;
+			break;
+		}
+
+		if( idx->kind == ANN_EXONS )
+		{
+			AnnChrom & c = idx->chroms[key];
+			unsigned char malformed;
+			uint64_t exons;
+
+			err |= ann_get( fd, &malformed, 1 ) || ann_get( fd, &c.maxLen, sizeof( c.maxLen ) ) || ann_get( fd, &exons, sizeof( exons ) );
+			if( err )
+				break;
+
+			c.malformed = malformed;
+			c.exons.resize( exons );
+			err |= exons && ann_get( fd, c.exons.data(), exons * sizeof( AnnInterval ) );
+		}
+		else
+		{
+			AnnGene & g = idx->genes[key];
+			err |= ann_get_string( fd, &g.chrom ) || ann_get( fd, &g.start, sizeof( g.start ) ) || ann_get( fd, &g.end, sizeof( g.end ) );
+		}
+	}
+
+	fclose( fd );
+
+	if( err )
+	{
+		idx->chroms.clear();
+		idx->genes.clear();
+	}
+
+return err;
+}
+
+/*
+Builds the index of an exon (kind ANN_EXONS) or gene (ANN_GENES) file. With
+-i 1 the index is read from its sidecar file when that is up to date with the
+annotation file, and saved to it otherwise.
+*/
+static int ann_index( const char * filename, int kind, AnnIndex * idx, TSwitch sw )
+{
+	struct stat st;
+
+	idx->kind = kind;
+	idx->chroms.clear();
+	idx->genes.clear();
+
+	if( sw . i == 1 && stat( filename, &st ) == 0 )
+	{
+		string sidecar = ann_sidecar( filename, kind );
+
+		if( ann_load( sidecar, idx, &st ) == 0 )
+			return 0;
+
+		if( ann_parse( filename, idx ) )
+			return ( 1 );
+
+		if( ann_save( sidecar, idx, &st ) )
+			fprintf( stderr, " Warning: Cannot write index file %s!\n", sidecar.c_str() );
+
+		return 0;
+	}
+
+return ann_parse( filename, idx );
+}
+
+int ann_index_exons( const char * filename, AnnIndex * idx, TSwitch sw )
+{
+	return ann_index( filename, ANN_EXONS, idx, sw );
+}
+
+int ann_index_genes( const char * filename, AnnIndex * idx, TSwitch sw )
+{
+	return ann_index( filename, ANN_GENES, idx, sw );
+}
+
+/*
+The gene called name (upper case), or NULL
+*/
+AnnGene * ann_find_gene( AnnIndex * idx, const string & name )
+{
+	auto it = idx->genes.find( name );
+
+	if( it == idx->genes.end() )
+		return NULL;
+
+return &it->second;
+}
+
+/*
+Appends to exons the exons of chromosome chrom (upper case) that overlap
+[start, end], or all of them unless both start and end are positive. Only exons
+that start at most maxLen before start can reach it, so the search begins there.
+Returns 1 if a line of the chromosome has coordinates that are not numbers.
+*/
+int ann_exons( AnnIndex * idx, const string & chrom, unsigned int start, unsigned int end, vector<AnnInterval> * exons )
+{
+	auto it = idx->chroms.find( chrom );
+
+	if( it == idx->chroms.end() )
+		return 0;
+
+	AnnChrom & c = it->second;
+
+	if( c.malformed )
+		return ( 1 );
+
+	if( start == 0 || end == 0 )
+	{
+		exons->insert( exons->end(), c.exons.begin(), c.exons.end() );
+		return 0;
+	}
+
+	AnnInterval lo = { ( start > c.maxLen ) ? start - c.maxLen : 0, 0 };
+
+	for( auto e = lower_bound( c.exons.begin(), c.exons.end(), lo, order_interval ); e != c.exons.end() && e->start <= end; ++e )
+		if( e->end >= start )
+			exons->push_back( *e );
+
+return 0;
+}
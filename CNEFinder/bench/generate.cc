@@ -0,0 +1,357 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+using namespace std;
+
+/*
+Synthetic input for the benchmarks: two random genomes with mutated copies of
+the same elements planted at matching places, repeats, N runs, soft-masked runs
+and exons. The same options and seed always give the same files.
+*/
+struct GenSwitch
+ {
+   char			* prefix;
+   const char		* chrom;
+   unsigned int		n, N, e, l, u, R;
+   double		i, d, r, m, s, x;
+   uint64_t		seed;
+ };
+
+struct Planted
+ {
+   unsigned int		startRef;
+   unsigned int		endRef;
+   unsigned int		startQuery;
+   unsigned int		endQuery;
+   unsigned int		edits;
+ };
+
+static uint64_t gen_state;
+
+/*
+splitmix64, so that the genomes do not depend on the C library
+*/
+static uint64_t gen_next( void )
+{
+	uint64_t z = ( gen_state += 0x9E3779B97F4A7C15ULL );
+
+	z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+	z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+
+return z ^ ( z >> 31 );
+}
+
+static double gen_unit( void )
+{
+	return ( gen_next() >> 11 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+static unsigned int gen_below( unsigned int n )
+{
+	return n ? gen_next() % n : 0;
+}
+
+static char gen_base( void )
+{
+	return "ACGT"[gen_next() & 3];
+}
+
+static void gen_random( string * s, unsigned int len )
+{
+	for( unsigned int k = 0; k < len; k++ )
+		s->push_back( gen_base() );
+}
+
+/*
+Copy of e with each base substituted with probability sub, deleted with
+probability indel / 2 or followed by an inserted base with probability indel /
+2; returns the number of edits
+*/
+static unsigned int gen_mutate( const string & e, double sub, double indel, string * out )
+{
+	unsigned int edits = 0;
+
+	for( unsigned int k = 0; k < e.size(); k++ )
+	{
+		double p = gen_unit();
+
+		if( p < indel / 2 )
+		{
+			edits++;
+			continue;
+		}
+
+		if( p < indel / 2 + sub )
+		{
+			char b;
+
+			do b = gen_base(); while( b == e[k] );
+			out->push_back( b );
+			edits++;
+		}
+		else
+			out->push_back( e[k] );
+
+		if( gen_unit() < indel / 2 )
+		{
+			out->push_back( gen_base() );
+			edits++;
+		}
+	}
+
+return edits;
+}
+
+/*
+Whether [from, to) meets one of the sorted, disjoint intervals in starts/ends
+*/
+static bool gen_hits( vector<unsigned int> & starts, vector<unsigned int> & ends, unsigned int from, unsigned int to )
+{
+	unsigned int k = upper_bound( starts.begin(), starts.end(), from ) - starts.begin();
+
+	if( k > 0 && ends[k - 1] > from )
+		return true;
+
+return k < starts.size() && starts[k] < to;
+}
+
+/*
+Overwrites a fraction of s outside the elements: repeat copies with 10%
+substitutions, then runs of N, then soft-masked runs
+*/
+static void gen_background( string * s, vector<unsigned int> & starts, vector<unsigned int> & ends, const string & repeat, GenSwitch sw )
+{
+	unsigned int len = s->size();
+	double cover[3] = { sw . r, sw . m, sw . s };
+
+	for( int kind = 0; kind < 3; kind++ )
+	{
+		double want = cover[kind] * len;
+		double done = 0;
+		unsigned int tries = 0;
+
+		while( done < want && tries++ < 100 * ( want / 100 + 1 ) )
+		{
+			unsigned int run = kind == 0 ? repeat . size() : 100 + gen_below( 900 );
+
+			if( run >= len )
+				break;
+
+			unsigned int p = gen_below( len - run );
+
+			if( gen_hits( starts, ends, p, p + run ) )
+				continue;
+
+			for( unsigned int k = 0; k < run; k++ )
+			{
+				if( kind == 0 )
+					( *s )[p + k] = gen_unit() < 0.1 ? gen_base() : repeat[k];
+				else if( kind == 1 )
+					( *s )[p + k] = 'N';
+				else
+					( *s )[p + k] = tolower( ( *s )[p + k] );
+			}
+			done += run;
+		}
+	}
+}
+
+static int gen_fasta( const char * name, const char * chrom, const string & s )
+{
+	FILE * out;
+
+	if ( ! ( out = fopen ( name, "w" ) ) )
+	{
+		fprintf ( stderr, " Error: Cannot open file %s!\n", name );
+		return ( 1 );
+	}
+
+	fprintf( out, ">%s\n", chrom );
+	for( unsigned int k = 0; k < s . size(); k += 60 )
+		fprintf( out, "%.*s\n", ( int ) min( ( size_t ) 60, s . size() - k ), s . data() + k );
+
+	if ( fclose ( out ) )
+	{
+		fprintf( stderr, " Error: file close error!\n");
+		return ( 1 );
+	}
+
+return 0;
+}
+
+static void gen_usage( void )
+{
+	fprintf( stdout, " Usage: cnef-gen -o <prefix> [options]\n" );
+	fprintf( stdout, " Writes <prefix>_ref.fa, <prefix>_query.fa, <prefix>_ref_exons.bed, <prefix>_query_exons.bed and <prefix>_truth.tsv\n\n" );
+	fprintf( stdout, "  -n	<int>		Length of the reference genome. Default:100000.\n" );
+	fprintf( stdout, "  -N	<int>		Length of the query genome. Default: that of the reference.\n" );
+	fprintf( stdout, "  -e	<int>		Number of planted elements. Default:50.\n" );
+	fprintf( stdout, "  -l	<int>		Minimum length of an element. Default:100.\n" );
+	fprintf( stdout, "  -u	<int>		Maximum length of an element. Default:400.\n" );
+	fprintf( stdout, "  -i	<dbl>		Share of the bases of an element left as they are in its copy. Default:0.9.\n" );
+	fprintf( stdout, "  -d	<dbl>		Indel rate per base of an element, part of 1 - identity. Default:0.01.\n" );
+	fprintf( stdout, "  -r	<dbl>		Share of each genome covered by copies of a repeat. Default:0.\n" );
+	fprintf( stdout, "  -R	<int>		Length of the repeat. Default:300.\n" );
+	fprintf( stdout, "  -m	<dbl>		Share of each genome in runs of N. Default:0.\n" );
+	fprintf( stdout, "  -s	<dbl>		Share of each genome in soft-masked runs. Default:0.\n" );
+	fprintf( stdout, "  -x	<dbl>		Share of the elements covered by an exon. Default:0.\n" );
+	fprintf( stdout, "  -c	<str>		Chromosome name. Default:chr1.\n" );
+	fprintf( stdout, "  -S	<int>		Random seed. Default:1.\n" );
+}
+
+int main( int argc, char ** argv )
+{
+	GenSwitch sw = { NULL, "chr1", 100000, 0, 50, 100, 400, 300, 0.9, 0.01, 0, 0, 0, 0, 1 };
+	int opt;
+
+	while ( ( opt = getopt ( argc, argv, "o:n:N:e:l:u:i:d:r:R:m:s:x:c:S:h" ) ) != -1 )
+	{
+		switch ( opt )
+		{
+			case 'o': sw . prefix = optarg; break;
+			case 'n': sw . n = strtoul( optarg, NULL, 10 ); break;
+			case 'N': sw . N = strtoul( optarg, NULL, 10 ); break;
+			case 'e': sw . e = strtoul( optarg, NULL, 10 ); break;
+			case 'l': sw . l = strtoul( optarg, NULL, 10 ); break;
+			case 'u': sw . u = strtoul( optarg, NULL, 10 ); break;
+			case 'i': sw . i = atof( optarg ); break;
+			case 'd': sw . d = atof( optarg ); break;
+			case 'r': sw . r = atof( optarg ); break;
+			case 'R': sw . R = strtoul( optarg, NULL, 10 ); break;
+			case 'm': sw . m = atof( optarg ); break;
+			case 's': sw . s = atof( optarg ); break;
+			case 'x': sw . x = atof( optarg ); break;
+			case 'c': sw . chrom = optarg; break;
+			case 'S': sw . seed = strtoull( optarg, NULL, 10 ); break;
+			default: gen_usage(); return ( 1 );
+		}
+	}
+
+	if( sw . N == 0 )
+		sw . N = sw . n;
+
+	if( sw . prefix == NULL || sw . l == 0 || sw . l > sw . u || sw . i < 0 || sw . i > 1 || sw . d < 0 || sw . d > 1 - sw . i )
+	{
+		gen_usage();
+		return ( 1 );
+	}
+
+	/* Each element gets a slot of the same share of either genome, with room for insertions in the query */
+	unsigned int slotRef = sw . e ? sw . n / sw . e : 0;
+	unsigned int slotQuery = sw . e ? sw . N / sw . e : 0;
+
+	if( sw . e && ( slotRef <= sw . u || slotQuery <= sw . u + sw . u / 4 ) )
+	{
+		fprintf( stderr, " Error: %u elements of up to %u bases do not fit in the genomes!\n", sw . e, sw . u );
+		return ( 1 );
+	}
+
+	gen_state = sw . seed;
+
+	string ref, query, repeat;
+	vector<Planted> planted;
+	double sub = 1 - sw . i - sw . d;
+
+	gen_random( &repeat, sw . R );
+	ref . reserve( sw . n );
+	query . reserve( sw . N );
+
+	for( unsigned int k = 0; k < sw . e; k++ )
+	{
+		unsigned int len = sw . l + gen_below( sw . u - sw . l + 1 );
+		string element, copy;
+		Planted p;
+
+		gen_random( &element, len );
+		p . edits = gen_mutate( element, sub, sw . d, &copy );
+
+		p . startRef = k * slotRef + gen_below( slotRef - len );
+		gen_random( &ref, p . startRef - ref . size() );
+		ref += element;
+		p . endRef = ref . size();
+
+		/* Insertions can make a copy longer than its slot; the next one then starts after it */
+		p . startQuery = max( ( size_t ) k * slotQuery + gen_below( slotQuery > copy . size() ? slotQuery - copy . size() : 0 ), query . size() );
+		gen_random( &query, p . startQuery - query . size() );
+		query += copy;
+		p . endQuery = query . size();
+
+		planted . push_back( p );
+	}
+	gen_random( &ref, sw . n - ref . size() );
+	if( query . size() < sw . N )
+		gen_random( &query, sw . N - query . size() );
+
+	vector<unsigned int> refStarts, refEnds, queryStarts, queryEnds;
+
+	for( unsigned int k = 0; k < planted . size(); k++ )
+	{
+		refStarts . push_back( planted[k] . startRef );
+		refEnds . push_back( planted[k] . endRef );
+		queryStarts . push_back( planted[k] . startQuery );
+		queryEnds . push_back( planted[k] . endQuery );
+	}
+
+	gen_background( &ref, refStarts, refEnds, repeat, sw );
+	gen_background( &query, queryStarts, queryEnds, repeat, sw );
+
+	string name = string( sw . prefix );
+
+	if( gen_fasta( ( name + "_ref.fa" ) . c_str(), sw . chrom, ref ) || gen_fasta( ( name + "_query.fa" ) . c_str(), sw . chrom, query ) )
+		return ( 1 );
+
+	FILE * exRef = fopen( ( name + "_ref_exons.bed" ) . c_str(), "w" );
+	FILE * exQuery = fopen( ( name + "_query_exons.bed" ) . c_str(), "w" );
+	FILE * truth = fopen( ( name + "_truth.tsv" ) . c_str(), "w" );
+
+	if( ! exRef || ! exQuery || ! truth )
+	{
+		fprintf ( stderr, " Error: Cannot open the output files of %s!\n", sw . prefix );
+		return ( 1 );
+	}
+
+	/* Exons cover whole elements, which cnef must then leave out */
+	for( unsigned int k = 0; k < planted . size(); k++ )
+	{
+		bool exon = gen_unit() < sw . x;
+
+		if( exon )
+		{
+			fprintf( exRef, "%s\t%u\t%u\n", sw . chrom, planted[k] . startRef, planted[k] . endRef );
+			fprintf( exQuery, "%s\t%u\t%u\n", sw . chrom, planted[k] . startQuery, planted[k] . endQuery );
+		}
+		fprintf( truth, "%u\t%u\t%u\t%u\t%u\t%d\n", planted[k] . startRef, planted[k] . endRef, planted[k] . startQuery, planted[k] . endQuery, planted[k] . edits, exon );
+	}
+
+	if( fclose( exRef ) || fclose( exQuery ) || fclose( truth ) )
+	{
+		fprintf( stderr, " Error: file close error!\n");
+		return ( 1 );
+	}
+
+return 0;
+}
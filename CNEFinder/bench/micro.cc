@@ -0,0 +1,532 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "cnef.h"
+#include "edlib.h"
+
+using namespace std;
+
+/*
+Microbenchmarks of the alignment kernels and of the extension of single
+matches, each result checked against plain edlib: synthetic pairs over a grid of
+lengths and identities, and the extension inputs of real runs saved with
+CNEF_CAPTURE=<file>. Runs on one thread; exits with 1 if any result differs
+from edlib.
+*/
+struct MicroSwitch
+ {
+   unsigned int		n;
+   double		min_time;
+   uint64_t		seed;
+   bool			synthetic;
+   vector<char *>	captures;
+ };
+
+static const unsigned int micro_lengths[] = { 8, 16, 32, 64, 128, 256, 512, 1000, 2000 };
+static const unsigned int micro_identities[] = { 70, 80, 90, 95, 100 };
+static const char * micro_engines[] = { "greedy", "xdrop", "wfa" };
+
+static uint64_t micro_state;
+
+static uint64_t micro_next( void )
+{
+	uint64_t z = ( micro_state += 0x9E3779B97F4A7C15ULL );
+
+	z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+	z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+
+return z ^ ( z >> 31 );
+}
+
+static double micro_unit( void )
+{
+	return ( micro_next() >> 11 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+static char micro_base( void )
+{
+	return "ACGT"[micro_next() & 3];
+}
+
+static void micro_random( string * s, unsigned int len )
+{
+	for( unsigned int k = 0; k < len; k++ )
+		s->push_back( micro_base() );
+}
+
+/*
+Copy of e at about identity percent: each base is substituted with probability
+0.8 ( 1 - identity ), deleted with probability 0.1 ( 1 - identity ) or followed
+by an inserted base with probability 0.1 ( 1 - identity )
+*/
+static void micro_mutate( const string & e, unsigned int identity, string * out )
+{
+	double error = 1 - identity / 100.0;
+
+	for( unsigned int k = 0; k < e.size(); k++ )
+	{
+		double p = micro_unit();
+
+		if( p < 0.1 * error )
+			continue;
+
+		if( p < 0.9 * error )
+		{
+			char b;
+
+			do b = micro_base(); while( b == e[k] );
+			out->push_back( b );
+		}
+		else
+			out->push_back( e[k] );
+
+		if( micro_unit() < 0.1 * error )
+			out->push_back( micro_base() );
+	}
+}
+
+static double micro_clock( void )
+{
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+
+return t . tv_sec + t . tv_nsec * 1e-9;
+}
+
+/*
+The oracle: unit-cost global edit distance from edlib, with no band and no
+shortcut of ours
+*/
+static int micro_oracle( const char * x, int n, const char * y, int m )
+{
+	EdlibAlignResult result = edlibAlign( x, n, y, m, edlibNewAlignConfig( -1, EDLIB_MODE_NW, EDLIB_TASK_DISTANCE ) );
+	int score = result . editDistance;
+
+	edlibFreeAlignResult( result );
+
+return score;
+}
+
+struct MicroPair
+ {
+   string		x;
+   string		y;
+   int			score;
+ };
+
+static void micro_row( const char * kernel, const char * set, unsigned int length, unsigned int identity, size_t count, double seconds, double cells, unsigned int mismatches )
+{
+	printf( "%s\t%s\t%u\t%u\t%zu\t%.1f\t%.3e\t%u\n", kernel, set, length, identity, count, seconds * 1e9 / count, cells / seconds, mismatches );
+}
+
+/*
+Times kernel over all pairs, repeating the whole set until min_time has passed,
+and counts the pairs on which it does not give the oracle's distance
+*/
+static void micro_kernel( const char * kernel, const char * set, unsigned int length, unsigned int identity, vector<MicroPair> & pairs, MicroSwitch & ms, unsigned int * failed )
+{
+	Workspace ws;
+	vector<EdPair> batch( pairs.size() );
+	vector<int> scores( pairs.size() );
+	double cells = 0, seconds = 0;
+	size_t count = 0;
+
+	ws_init( &ws );
+
+	for( size_t i = 0; i < pairs.size(); i++ )
+	{
+		batch[i] . x = ( unsigned char * ) &pairs[i] . x[0];
+		batch[i] . n = pairs[i] . x . size();
+		batch[i] . y = ( unsigned char * ) &pairs[i] . y[0];
+		batch[i] . m = pairs[i] . y . size();
+		batch[i] . k = -1;
+		cells += ( double ) batch[i] . n * batch[i] . m;
+	}
+
+	double total = cells;
+
+	cells = 0;
+	do
+	{
+		double began = micro_clock();
+
+		if( ! strcmp( kernel, "batch" ) )
+		{
+			ws_reset( &ws );
+			editDistanceBatch( batch.data(), batch.size(), &ws );
+			for( size_t i = 0; i < pairs.size(); i++ )
+				scores[i] = batch[i] . score;
+		}
+		else for( size_t i = 0; i < pairs.size(); i++ )
+		{
+			unsigned char * x = ( unsigned char * ) pairs[i] . x . c_str();
+			unsigned char * y = ( unsigned char * ) pairs[i] . y . c_str();
+
+			ws_reset( &ws );
+			if( ! strcmp( kernel, "edlib" ) )
+				scores[i] = micro_oracle( ( char * ) x, batch[i] . n, ( char * ) y, batch[i] . m );
+			else if( ! strcmp( kernel, "myers" ) )
+				scores[i] = editDistanceMyers( x, y, &ws );
+			else
+				scores[i] = editDistanceWFA( x, y, &ws );
+		}
+
+		seconds += micro_clock() - began;
+		cells += total;
+		count += pairs.size();
+	}
+	while( seconds < ms . min_time );
+
+	unsigned int mismatches = 0;
+
+	for( size_t i = 0; i < pairs.size(); i++ )
+		if( scores[i] != pairs[i] . score )
+			mismatches++;
+
+	micro_row( kernel, set, length, identity, count, seconds, cells, mismatches );
+	*failed += mismatches;
+	ws_free( &ws );
+}
+
+/*
+Extends seed within ref and query as the extension stage of cnef does
+*/
+static void micro_extend( MimOcc * seed, unsigned char * ref, unsigned char * query, TSwitch sw, Workspace * ws, double * seconds )
+{
+	double began = micro_clock();
+
+	ws_reset( ws );
+	extend( &seed->error, ( int * ) &seed->startQuery, ( int * ) &seed->endQuery, ( int * ) &seed->startRef, ( int * ) &seed->endRef, ref, query, sw, ws );
+	adjust( &seed->error, ( int * ) &seed->startQuery, ( int * ) &seed->endQuery, ( int * ) &seed->startRef, ( int * ) &seed->endRef, ref, query, sw, ws );
+	*seconds += micro_clock() - began;
+}
+
+/*
+Times the extension of all seeds, repeating the whole set until min_time has
+passed, and counts the extensions whose distance, as left by adjust(), is not
+the oracle's distance of the final substrings; these substrings go to finals
+*/
+static void micro_extensions( const char * engine, const char * set, unsigned int length, unsigned int identity, vector<unsigned char *> & refs, vector<unsigned char *> & queries, vector<MimOcc> & seeds, TSwitch sw, MicroSwitch & ms, unsigned int * failed, vector<MicroPair> * finals )
+{
+	Workspace ws;
+	double seconds = 0, extended = 0;
+	size_t count = 0;
+	unsigned int mismatches = 0;
+
+	ws_init( &ws );
+
+	for( bool first = true; first || seconds < ms . min_time; first = false )
+		for( size_t i = 0; i < seeds.size(); i++ )
+		{
+			MimOcc occ = seeds[i];
+
+			micro_extend( &occ, refs[i], queries[i], sw, &ws, &seconds );
+			count++;
+
+			if( ! first )
+				continue;
+
+			MicroPair p;
+
+			p . x . assign( ( char * ) refs[i] + occ . startRef, occ . endRef - occ . startRef );
+			p . y . assign( ( char * ) queries[i] + occ . startQuery, occ . endQuery - occ . startQuery );
+			p . score = micro_oracle( p . x . c_str(), p . x . size(), p . y . c_str(), p . y . size() );
+			if( ( int ) occ . error != p . score )
+				mismatches++;
+			extended += max( p . x . size(), p . y . size() );
+			if( finals )
+				finals->push_back( p );
+		}
+
+	printf( "%s\t%s\t%u\t%u\t%zu\t%.1f\t%.1f\t%u\n", engine, set, length, identity, count, seconds * 1e9 / count, extended / seeds.size(), mismatches );
+	*failed += mismatches;
+	ws_free( &ws );
+}
+
+/*
+Whether cnef would extend the match: the condition of its extension loop
+*/
+static bool micro_eligible( MimOcc & occ, TSwitch & sw )
+{
+	double minLen = min( occ . endRef - occ . startRef, occ . endQuery - occ . startQuery );
+	double maxLen = max( occ . endRef - occ . startRef, occ . endQuery - occ . startQuery );
+
+return minLen > 0 && occ . error / minLen < sw . t && maxLen <= sw . u;
+}
+
+static void micro_synthetic( MicroSwitch & ms, TSwitch sw, unsigned int * failed )
+{
+	printf( "kernel\tset\tlength\tidentity\talignments\tns/alignment\tcells/s\tmismatches\n" );
+
+	for( unsigned int length : micro_lengths )
+		for( unsigned int identity : micro_identities )
+		{
+			vector<MicroPair> pairs( ms . n );
+
+			for( MicroPair & p : pairs )
+			{
+				micro_random( &p . x, length );
+				micro_mutate( p . x, identity, &p . y );
+				if( p . y . empty() )
+					p . y . push_back( micro_base() );
+				p . score = micro_oracle( p . x . c_str(), p . x . size(), p . y . c_str(), p . y . size() );
+			}
+
+			micro_kernel( "edlib", "synthetic", length, identity, pairs, ms, failed );
+			micro_kernel( "myers", "synthetic", length, identity, pairs, ms, failed );
+			micro_kernel( "batch", "synthetic", length, identity, pairs, ms, failed );
+			micro_kernel( "wfa", "synthetic", length, identity, pairs, ms, failed );
+		}
+
+	/*
+	Extension of an element at the given identity, planted between unrelated
+	flanks of the same length, from a seed over its middle third; -t is set just
+	above the divergence so that the element is worth extending
+	*/
+	printf( "\nengine\tset\tlength\tidentity\textensions\tns/extension\tmean length\tmismatches\n" );
+
+	for( int E = EXT_GREEDY; E <= EXT_WFA; E++ )
+		for( unsigned int length : micro_lengths )
+			for( unsigned int identity : micro_identities )
+			{
+				if( length < 3 * sw . l / 2 )
+					continue;
+
+				sw . E = E;
+				sw . t = 1 - identity / 100.0 + 0.05;
+				sw . u = 3 * length;
+
+				vector<string> refs, queries;
+				vector<MimOcc> seeds;
+
+				for( unsigned int i = 0; i < ms . n; i++ )
+				{
+					string e, c, ref, query;
+
+					micro_random( &e, length );
+					micro_mutate( e, identity, &c );
+					micro_random( &ref, length );
+					micro_random( &query, length );
+
+					MimOcc seed;
+
+					seed . startRef = ref . size() + length / 3;
+					seed . endRef = ref . size() + 2 * length / 3;
+					seed . startQuery = query . size() + c . size() / 3;
+					seed . endQuery = query . size() + 2 * c . size() / 3;
+
+					ref += e;
+					query += c;
+					micro_random( &ref, length );
+					micro_random( &query, length );
+
+					seed . error = micro_oracle( ref . c_str() + seed . startRef, seed . endRef - seed . startRef, query . c_str() + seed . startQuery, seed . endQuery - seed . startQuery );
+					if( ! micro_eligible( seed, sw ) )
+						continue;
+
+					refs . push_back( ref );
+					queries . push_back( query );
+					seeds . push_back( seed );
+				}
+
+				if( seeds.empty() )
+					continue;
+
+				vector<unsigned char *> r, q;
+
+				for( size_t i = 0; i < seeds.size(); i++ )
+				{
+					r . push_back( ( unsigned char * ) &refs[i][0] );
+					q . push_back( ( unsigned char * ) &queries[i][0] );
+				}
+
+				micro_extensions( micro_engines[E], "synthetic", length, identity, r, q, seeds, sw, ms, failed, NULL );
+			}
+}
+
+/*
+Mean length and identity of pairs, for the rows of a capture
+*/
+static void micro_shape( vector<MicroPair> & pairs, unsigned int * length, unsigned int * identity )
+{
+	double l = 0, d = 0;
+
+	for( MicroPair & p : pairs )
+	{
+		double m = max( p . x . size(), p . y . size() );
+
+		l += m;
+		d += m ? 1 - p . score / m : 1;
+	}
+
+	*length = pairs.empty() ? 0 : l / pairs.size() + 0.5;
+	*identity = pairs.empty() ? 0 : 100 * d / pairs.size() + 0.5;
+}
+
+/*
+Replays the extension stage of a captured run with each engine on the seeds cnef
+would extend, then times the kernels on the substrings the captured engine ended
+with. Unlike cnef, every eligible seed is extended: cnef skips those that fall
+inside a CNE found in an earlier wave
+*/
+static int micro_replay( char * filename, MicroSwitch & ms, TSwitch sw, unsigned int * failed )
+{
+	Capture c;
+
+	c . sw = sw;
+	if( capture_read( filename, &c ) )
+		return ( 1 );
+
+	const char * set = strrchr( filename, '/' ) ? strrchr( filename, '/' ) + 1 : filename;
+	vector<unsigned char *> refs, queries;
+	vector<MimOcc> seeds;
+	vector<MicroPair> eligible, finals;
+
+	for( MimOcc & occ : c . seeds )
+		if( micro_eligible( occ, c . sw ) )
+		{
+			MicroPair p;
+
+			p . x . assign( c . ref, occ . startRef, occ . endRef - occ . startRef );
+			p . y . assign( c . query, occ . startQuery, occ . endQuery - occ . startQuery );
+			p . score = occ . error;
+			eligible . push_back( p );
+			seeds . push_back( occ );
+			refs . push_back( ( unsigned char * ) &c . ref[0] );
+			queries . push_back( ( unsigned char * ) &c . query[0] );
+		}
+
+	fprintf( stderr, " %s: %zu of %zu seeds to extend, -E %s\n", set, seeds.size(), c . seeds.size(), micro_engines[c . sw . E] );
+	if( seeds.empty() )
+		return ( 0 );
+
+	unsigned int length, identity;
+
+	micro_shape( eligible, &length, &identity );
+	printf( "\nengine\tset\tlength\tidentity\textensions\tns/extension\tmean length\tmismatches\n" );
+	for( int E = EXT_GREEDY; E <= EXT_WFA; E++ )
+	{
+		TSwitch e = c . sw;
+
+		e . E = E;
+		micro_extensions( micro_engines[E], set, length, identity, refs, queries, seeds, e, ms, failed, E == c . sw . E ? &finals : NULL );
+	}
+
+	micro_shape( finals, &length, &identity );
+	printf( "\nkernel\tset\tlength\tidentity\talignments\tns/alignment\tcells/s\tmismatches\n" );
+	micro_kernel( "edlib", set, length, identity, finals, ms, failed );
+	micro_kernel( "myers", set, length, identity, finals, ms, failed );
+	micro_kernel( "batch", set, length, identity, finals, ms, failed );
+	micro_kernel( "wfa", set, length, identity, finals, ms, failed );
+
+return 0;
+}
+
+static void micro_usage( void )
+{
+	fprintf( stderr, " Usage: cnef-micro <options>\n" );
+	fprintf( stderr, " Times the alignment kernels and the extension of single matches against edlib.\n" );
+	fprintf( stderr, "  -c, --capture        <str>     A file saved by cnef with CNEF_CAPTURE=<file>; may be repeated.\n" );
+	fprintf( stderr, "  -x, --no-synthetic             Only replay the captures.\n" );
+	fprintf( stderr, "  -n, --pairs          <int>     Synthetic pairs or elements per length and identity (default: 100).\n" );
+	fprintf( stderr, "  -T, --min-time       <dbl>     Seconds each row is timed for at least (default: 0.05).\n" );
+	fprintf( stderr, "  -l, --min-seq-length <int>     -l of cnef for the synthetic extensions (default: 50).\n" );
+	fprintf( stderr, "  -s, --ext-threshold  <dbl>     -s of cnef for the synthetic extensions (default: 0.05).\n" );
+	fprintf( stderr, "  -S, --seed           <int>     Seed of the synthetic pairs (default: 1).\n" );
+}
+
+int main( int argc, char ** argv )
+{
+	static struct option long_options[] =
+	 {
+	   { "capture",		required_argument, NULL, 'c' },
+	   { "no-synthetic",	no_argument,       NULL, 'x' },
+	   { "pairs",		required_argument, NULL, 'n' },
+	   { "min-time",		required_argument, NULL, 'T' },
+	   { "min-seq-length",	required_argument, NULL, 'l' },
+	   { "ext-threshold",	required_argument, NULL, 's' },
+	   { "seed",		required_argument, NULL, 'S' },
+	   { "help",		no_argument,       NULL, 'h' },
+	   { NULL,		0,                 NULL,  0  }
+	 };
+	MicroSwitch ms;
+	TSwitch sw;
+	int opt;
+
+	/* The switches of cnef that extend() and adjust() read, at their defaults */
+	memset( &sw, 0, sizeof( sw ) );
+	sw . l = 50;
+	sw . u = 2000;
+	sw . t = 1.0;
+	sw . s = 0.05;
+	sw . p = 1;
+	sw . M = 0.5;
+	sw . E = EXT_GREEDY;
+
+	ms . n = 100;
+	ms . min_time = 0.05;
+	ms . seed = 1;
+	ms . synthetic = true;
+
+	while( ( opt = getopt_long( argc, argv, "c:xn:T:l:s:S:h", long_options, NULL ) ) != -1 )
+	{
+		switch( opt )
+		{
+			case 'c': ms . captures . push_back( optarg ); break;
+			case 'x': ms . synthetic = false; break;
+			case 'n': ms . n = strtoul( optarg, NULL, 10 ); break;
+			case 'T': ms . min_time = atof( optarg ); break;
+			case 'l': sw . l = strtoul( optarg, NULL, 10 ); break;
+			case 's': sw . s = atof( optarg ); break;
+			case 'S': ms . seed = strtoull( optarg, NULL, 10 ); break;
+			default: micro_usage(); return ( 1 );
+		}
+	}
+
+	if( optind < argc || ms . n == 0 || sw . l == 0 )
+	{
+		micro_usage();
+		return ( 1 );
+	}
+
+	micro_state = ms . seed;
+
+	unsigned int failed = 0;
+
+	if( ms . synthetic )
+		micro_synthetic( ms, sw, &failed );
+
+	for( char * filename : ms . captures )
+		if( micro_replay( filename, ms, sw, &failed ) )
+			return ( 1 );
+
+	if( failed )
+		fprintf( stderr, " Error: %u results differ from edlib!\n", failed );
+
+return failed ? 1 : 0;
+}
@@ -0,0 +1,303 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <getopt.h>
+#include <omp.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include "cnef.h"
+
+using namespace std;
+
+/*
+Replays the cnef calls kept with CNEF_RECORD=<dir> in this process, from their
+extracted regions to their output, and reports the latency of the calls by
+kind, the output file name of the call without its directory (for the calls of
+starfish flank: DRs upstream, DRs downstream and TIRs). The calls run one after
+the other, each on -T threads: E-MEM keeps its state in static members, so
+calls cannot share a process side by side.
+*/
+struct ReplaySwitch
+ {
+   int			T;
+   unsigned int		n;
+   char			* work;
+   char			* out_dir;
+   bool			verbose;
+ };
+
+struct ReplayCall
+ {
+   Record		rec;
+   string		name;
+   string		kind;
+ };
+
+struct ReplayKind
+ {
+   vector<double>	latency;
+   unsigned int		empty;
+ };
+
+static double replay_clock( void )
+{
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+
+return t . tv_sec + t . tv_nsec * 1e-9;
+}
+
+/*
+Record files named by path: the file itself, or every file of a directory in
+name order
+*/
+static int replay_files( const char * path, vector<string> * files )
+{
+	struct stat st;
+
+	if( stat( path, &st ) )
+	{
+		fprintf( stderr, " Error: Cannot open %s!\n", path );
+		return ( 1 );
+	}
+
+	if( ! S_ISDIR( st . st_mode ) )
+	{
+		files->push_back( path );
+		return ( 0 );
+	}
+
+	DIR * dir = opendir( path );
+	struct dirent * e;
+	vector<string> found;
+
+	if( ! dir )
+	{
+		fprintf( stderr, " Error: Cannot open %s!\n", path );
+		return ( 1 );
+	}
+
+	while( ( e = readdir( dir ) ) )
+		if( e->d_name[0] != '.' )
+			found . push_back( string( path ) + "/" + e->d_name );
+	closedir( dir );
+
+	sort( found.begin(), found.end() );
+	files->insert( files->end(), found.begin(), found.end() );
+
+return 0;
+}
+
+/*
+Runs one call as cnef would from its extracted regions; the output goes to out.
+Returns 1 if the search found no matches, as cnef exits with 1 then
+*/
+static int replay_call( ReplayCall & call, ReplaySwitch & rs, FILE * out )
+{
+	TSwitch sw = call . rec . sw;
+	vector<MimOcc> mims;
+	SeqMasks masks = call . rec . masks;
+	unsigned int ref_len = call . rec . ref . size();
+	unsigned int query_len = call . rec . query . size();
+	unsigned char * ref = ( unsigned char * ) calloc( ref_len + 1, sizeof( unsigned char ) );
+	unsigned char * query = ( unsigned char * ) calloc( query_len + 1, sizeof( unsigned char ) );
+
+	memcpy( ref, call . rec . ref . data(), ref_len );
+	memcpy( query, call . rec . query . data(), query_len );
+	sw . T = rs . T;
+	sw . output_filename = rs . work;
+
+	int empty = find_cnes( sw, ref, ref_len, query, query_len, &masks, call . rec . q_gram_size, &mims );
+
+	if( ! empty && out )
+		write_cnes( out, &mims, sw, call . rec . chrRef, call . rec . startRef, call . rec . chrQuery, call . rec . startQuery );
+
+	free( ref );
+	free( query );
+
+return empty;
+}
+
+static double replay_percentile( vector<double> & sorted, double p )
+{
+	size_t k = ceil( p / 100 * sorted.size() );
+
+return sorted[ k ? k - 1 : 0 ];
+}
+
+static void replay_row( const char * kind, vector<double> & latency, unsigned int empty )
+{
+	double total = 0;
+
+	sort( latency.begin(), latency.end() );
+	for( double l : latency )
+		total += l;
+
+	printf( "%s\t%zu\t%u\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\n", kind, latency.size(), empty, 1e3 * total / latency.size(),
+		1e3 * replay_percentile( latency, 50 ), 1e3 * replay_percentile( latency, 90 ), 1e3 * replay_percentile( latency, 99 ), 1e3 * latency.back(), total, latency.size() / total );
+}
+
+static void replay_usage( void )
+{
+	fprintf( stderr, " Usage: cnef-replay <options> <record file or directory> ...\n" );
+	fprintf( stderr, " Replays cnef calls recorded with CNEF_RECORD=<dir> and reports their latency.\n" );
+	fprintf( stderr, "  -T, --threads        <int>     Threads of each call (default: 1).\n" );
+	fprintf( stderr, "  -n, --repeats        <int>     Times the whole corpus is replayed (default: 1).\n" );
+	fprintf( stderr, "  -o, --output-dir     <str>     Write the output of each call to <dir>/<record name>.out.\n" );
+	fprintf( stderr, "  -w, --work           <str>     Prefix of the E-MEM input files (default: cnef-replay).\n" );
+	fprintf( stderr, "  -V, --verbose                  Keep the messages of cnef on the standard error.\n" );
+}
+
+int main( int argc, char ** argv )
+{
+	static struct option long_options[] =
+	 {
+	   { "threads",		required_argument, NULL, 'T' },
+	   { "repeats",		required_argument, NULL, 'n' },
+	   { "output-dir",	required_argument, NULL, 'o' },
+	   { "work",		required_argument, NULL, 'w' },
+	   { "verbose",		no_argument,       NULL, 'V' },
+	   { "help",		no_argument,       NULL, 'h' },
+	   { NULL,		0,                 NULL,  0  }
+	 };
+	ReplaySwitch rs;
+	int opt;
+
+	rs . T = 1;
+	rs . n = 1;
+	rs . work = ( char * ) "cnef-replay";
+	rs . out_dir = NULL;
+	rs . verbose = false;
+
+	while( ( opt = getopt_long( argc, argv, "T:n:o:w:Vh", long_options, NULL ) ) != -1 )
+	{
+		switch( opt )
+		{
+			case 'T': rs . T = atoi( optarg ); break;
+			case 'n': rs . n = strtoul( optarg, NULL, 10 ); break;
+			case 'o': rs . out_dir = optarg; break;
+			case 'w': rs . work = optarg; break;
+			case 'V': rs . verbose = true; break;
+			default: replay_usage(); return ( 1 );
+		}
+	}
+
+	if( optind == argc || rs . T < 1 || rs . n == 0 )
+	{
+		replay_usage();
+		return ( 1 );
+	}
+
+	/* The corpus is loaded first, so that reading it is not timed */
+	vector<string> files;
+
+	for( int i = optind; i < argc; i++ )
+		if( replay_files( argv[i], &files ) )
+			return ( 1 );
+
+	vector<ReplayCall> calls( files.size() );
+
+	for( size_t i = 0; i < files.size(); i++ )
+	{
+		if( record_read( files[i] . c_str(), &calls[i] . rec ) )
+			return ( 1 );
+
+		size_t slash = files[i] . rfind( '/' );
+		size_t kind = calls[i] . rec . output . rfind( '/' );
+
+		calls[i] . name = files[i] . substr( slash == string::npos ? 0 : slash + 1 );
+		calls[i] . kind = calls[i] . rec . output . substr( kind == string::npos ? 0 : kind + 1 );
+	}
+
+	if( calls.empty() )
+	{
+		fprintf( stderr, " Error: No records found!\n" );
+		return ( 1 );
+	}
+
+	fprintf( stderr, " Replaying %zu calls %u time(s) on %d thread(s)\n", calls.size(), rs . n, rs . T );
+	omp_set_num_threads( rs . T );
+
+	/* cnef reports each stage of each call; these messages are dropped unless -V */
+	int saved = dup( 2 );
+
+	if( ! rs . verbose )
+	{
+		int null = open( "/dev/null", O_WRONLY );
+
+		dup2( null, 2 );
+		close( null );
+	}
+
+	map<string, ReplayKind> kinds;
+	ReplayKind all;
+
+	all . empty = 0;
+	for( unsigned int r = 0; r < rs . n; r++ )
+		for( ReplayCall & call : calls )
+		{
+			FILE * out = NULL;
+
+			if( rs . out_dir && r == 0 && ! ( out = fopen( ( string( rs . out_dir ) + "/" + call . name + ".out" ) . c_str(), call . rec . sw . O == OUT_BIN ? "wb" : "w" ) ) )
+			{
+				dup2( saved, 2 );
+				fprintf( stderr, " Error: Cannot open file %s/%s.out!\n", rs . out_dir, call . name . c_str() );
+				return ( 1 );
+			}
+
+			double began = replay_clock();
+			int empty = replay_call( call, rs, out );
+			double latency = replay_clock() - began;
+
+			if( out )
+				fclose( out );
+
+			ReplayKind & k = kinds[ call . kind ];
+
+			k . latency . push_back( latency );
+			all . latency . push_back( latency );
+			k . empty += empty;
+			all . empty += empty;
+		}
+
+	dup2( saved, 2 );
+	close( saved );
+
+	unlink( ( string( rs . work ) + "_new_ref.fa" ) . c_str() );
+	unlink( ( string( rs . work ) + "_new_query.fa" ) . c_str() );
+
+	printf( "kind\tcalls\tno matches\tmean ms\tp50 ms\tp90 ms\tp99 ms\tmax ms\ttotal s\tcalls/s\n" );
+	for( auto & k : kinds )
+		replay_row( k . first . c_str(), k . second . latency, k . second . empty );
+	if( kinds.size() > 1 )
+		replay_row( "all", all . latency, all . empty );
+
+return 0;
+}
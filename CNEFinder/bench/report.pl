@@ -0,0 +1,60 @@
+#!/usr/bin/env perl
+use warnings;
+use strict;
+use JSON::PP;
+
+# One row of the benchmark table from a cnef --stats file, its CNEs and the
+# elements cnef-gen planted.
+# usage: report.pl STATS CNES TRUTH REF_LEN QUERY_LEN THREADS BASE_WALL BASE_THREADS
+
+my ($statsFile, $cneFile, $truthFile, $refLen, $queryLen, $threads, $baseWall, $baseThreads) = @ARGV;
+die "usage: report.pl STATS CNES TRUTH REF_LEN QUERY_LEN THREADS BASE_WALL BASE_THREADS\n" if (not defined $baseThreads);
+
+my @STAGES = qw(load masking index seeding mem_dedup merge extension adjust overlaps output);
+
+open(my $statsIN, '<', $statsFile) or die "Error: cannot open $statsFile\n";
+my $stats = decode_json(do { local $/; <$statsIN> });
+close($statsIN);
+
+my @cnes;
+if (open(my $cneIN, '<', $cneFile)) {
+	while (my $line = <$cneIN>) {
+		my @f = split/\t/, $line;
+		push @cnes, [$f[1], $f[2], $f[4], $f[5]];
+	}
+	close($cneIN);
+}
+
+# an element is found when one CNE overlaps it in both genomes; elements under exons are not expected
+my ($planted, $found) = (0, 0);
+open(my $truthIN, '<', $truthFile) or die "Error: cannot open $truthFile\n";
+while (my $line = <$truthIN>) {
+	chomp $line;
+	my ($rs, $re, $qs, $qe, $edits, $exon) = split/\t/, $line;
+	next if ($exon);
+	$planted++;
+	foreach my $c (@cnes) {
+		if ($c->[0] < $re && $c->[1] > $rs && $c->[2] < $qe && $c->[3] > $qs) {
+			$found++;
+			last;
+		}
+	}
+}
+close($truthIN);
+
+my $wall = $stats->{total}->{wall_s};
+my $cells = $refLen * $queryLen;
+my @row = (
+	sprintf("%.3f", $wall),
+	sprintf("%.3f", $stats->{total}->{cpu_s}),
+	sprintf("%.4g", $wall > 0 ? $cells / $wall : 0),
+	scalar(@cnes),
+	sprintf("%.1f", $wall > 0 ? scalar(@cnes) / $wall : 0),
+	sprintf("%.3f", $planted ? $found / $planted : 1),
+	sprintf("%.2f", $wall > 0 ? ($baseWall * $baseThreads) / ($wall * $threads) : 0),
+	$stats->{total}->{peak_rss_kb},
+);
+foreach my $stage (@STAGES) {
+	push @row, sprintf("%.3f", $stats->{stages}->{$stage}->{wall_s});
+}
+print join("\t", @row), "\n";
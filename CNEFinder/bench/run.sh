@@ -0,0 +1,62 @@
+#!/bin/bash
+
+# Benchmarks cnef on genomes from cnef-gen at several region sizes, -Q/-l/-t
+# settings and thread counts. Each setting runs at every thread count of
+# THREADS; efficiency is relative to the first of them. Run from CNEFinder/ or
+# through 'make bench'; every variable below can be set from the environment.
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+CNEF=${CNEF:-$BENCH_DIR/../cnef}
+GEN=${GEN:-$BENCH_DIR/cnef-gen}
+OUT=${OUT:-$BENCH_DIR/out}
+SIZES=${SIZES:-"50000 200000 1000000"}
+SETTINGS=${SETTINGS:-"18:50:0.8 12:30:0.85"}	# -Q:-l:-t
+THREADS=${THREADS:-"1 2 4"}
+GENFLAGS=${GENFLAGS:-"-i 0.9 -d 0.01 -r 0.05 -m 0.01 -s 0.02 -x 0.1"}
+SEED=${SEED:-1}
+
+for f in "$CNEF" "$GEN"; do
+	if [ ! -x "$f" ]; then
+		echo "Error: $f not found; run 'make bench' in CNEFinder/"
+		exit 1
+	fi
+done
+
+mkdir -p "$OUT" || { echo "Error: cannot create $OUT"; exit 1; }
+RESULTS=$OUT/results.tsv
+
+printf "size\tQ\tl\tt\tthreads\twall_s\tcpu_s\tbp2_per_s\tcnes\tcnes_per_s\trecall\tefficiency\tpeak_rss_kb\tload\tmasking\tindex\tseeding\tmem_dedup\tmerge\textension\tadjust\toverlaps\toutput\n" > "$RESULTS"
+
+for size in $SIZES; do
+	data=$OUT/gen_$size
+	# one planted element per 2 kb
+	"$GEN" -o "$data" -n "$size" -e $(( size / 2000 )) -S "$SEED" $GENFLAGS || { echo "Error: cnef-gen failed for size $size"; exit 1; }
+
+	for setting in $SETTINGS; do
+		IFS=: read -r Q l t <<< "$setting"
+		baseWall=""
+		baseThreads=""
+
+		for T in $THREADS; do
+			run=$OUT/run_${size}_Q${Q}_l${l}_t${t}_T${T}
+			"$CNEF" -r "${data}_ref.fa" -q "${data}_query.fa" -e "${data}_ref_exons.bed" -f "${data}_query_exons.bed" \
+				-y 1 -z 1 -a 0 -b $(( size - 1 )) -c 0 -d $(( size - 1 )) \
+				-Q "$Q" -l "$l" -t "$t" -T "$T" -S "$run.json" -o "$run.out" 2> "$run.err"
+
+			if [ ! -s "$run.json" ]; then
+				echo "Warning: cnef produced no statistics for size $size, $setting, $T threads; see $run.err"
+				continue
+			fi
+
+			if [ -z "$baseWall" ]; then
+				baseWall=$(perl -MJSON::PP -e 'local $/; open(my $f, "<", $ARGV[0]) or die; print decode_json(<$f>)->{total}->{wall_s}' "$run.json")
+				baseThreads=$T
+			fi
+
+			row=$(perl "$BENCH_DIR/report.pl" "$run.json" "$run.out" "${data}_truth.tsv" "$size" "$size" "$T" "$baseWall" "$baseThreads") || exit 1
+			printf "%s\t%s\t%s\t%s\t%s\t%s\n" "$size" "$Q" "$l" "$t" "$T" "$row" >> "$RESULTS"
+		done
+	done
+done
+
+column -t -s $'\t' "$RESULTS" 2>/dev/null || cat "$RESULTS"
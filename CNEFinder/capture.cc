@@ -0,0 +1,322 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include <string>
+#include "cnef.h"
+
+using namespace std;
+
+static const char cap_magic[8] = { 'C', 'N', 'E', 'F', 'C', 'A', 'P', '\0' };
+static const char rec_magic[8] = { 'C', 'N', 'E', 'F', 'R', 'E', 'C', '\0' };
+
+/*
+A capture holds what the extension stage of one run starts from, for replaying
+extend() and adjust() outside cnef:
+
+	char[8]		"CNEFCAP\0"
+	uint32		format version (CAPTURE_VERSION)
+	double[3]	-t, -s, -M
+	int32[2]	-p, -E
+	uint32[2]	-l, -u
+	uint32, char[]	reference region with '$' at masked positions: length, bases
+	uint32, char[]	query region, the same way
+	uint64		number of seeds
+	MimOcc[]	the merged matches handed to extend(), in region positions
+
+Numbers are in the byte order of the machine that wrote the file.
+*/
+static int cap_put( FILE * out, const void * v, size_t n )
+{
+	return fwrite( v, 1, n, out ) != n;
+}
+
+static int cap_get( FILE * in, void * v, size_t n )
+{
+	return fread( v, 1, n, in ) != n;
+}
+
+/*
+Writes the capture of a run with switches sw on regions ref and query, whose
+extension starts from seeds; set CNEF_CAPTURE=<file> to have cnef call this
+*/
+int capture_write( const char * filename, TSwitch sw, unsigned char * ref, unsigned char * query, vector<MimOcc> * seeds )
+{
+	FILE * out;
+	uint32_t version = CAPTURE_VERSION;
+	double real[3] = { sw . t, sw . s, sw . M };
+	int32_t flags[2] = { sw . p, sw . E };
+	uint32_t lengths[2] = { sw . l, ( uint32_t ) sw . u };
+	uint32_t lenRef = strlen( ( char * ) ref );
+	uint32_t lenQuery = strlen( ( char * ) query );
+	uint64_t count = seeds->size();
+
+	if ( ! ( out = fopen ( filename, "wb" ) ) )
+	{
+		fprintf ( stderr, " Error: Cannot open file %s!\n", filename );
+		return ( 1 );
+	}
+
+	if( cap_put( out, cap_magic, sizeof( cap_magic ) ) || cap_put( out, &version, sizeof( version ) ) || cap_put( out, real, sizeof( real ) ) || cap_put( out, flags, sizeof( flags ) ) || cap_put( out, lengths, sizeof( lengths ) )
+	 || cap_put( out, &lenRef, sizeof( lenRef ) ) || cap_put( out, ref, lenRef ) || cap_put( out, &lenQuery, sizeof( lenQuery ) ) || cap_put( out, query, lenQuery )
+	 || cap_put( out, &count, sizeof( count ) ) || ( count && cap_put( out, seeds->data(), count * sizeof( MimOcc ) ) ) )
+	{
+		fprintf( stderr, " Error: Cannot write to file %s!\n", filename );
+		fclose( out );
+		return ( 1 );
+	}
+
+	if ( fclose ( out ) )
+	{
+		fprintf( stderr, " Error: file close error!\n");
+		return ( 1 );
+	}
+
+return 0;
+}
+
+static int cap_get_string( FILE * in, string * s )
+{
+	uint32_t len;
+
+	if( cap_get( in, &len, sizeof( len ) ) )
+		return ( 1 );
+
+	s->resize( len );
+
+return len && cap_get( in, &( *s )[0], len );
+}
+
+/*
+Loads a capture; the switches not in it keep the values of c->sw
+*/
+int capture_read( const char * filename, Capture * c )
+{
+	FILE * in;
+	char magic[8];
+	uint32_t version;
+	double real[3];
+	int32_t flags[2];
+	uint32_t lengths[2];
+	uint64_t count;
+
+	if ( ! ( in = fopen ( filename, "rb" ) ) )
+	{
+		fprintf ( stderr, " Error: Cannot open file %s!\n", filename );
+		return ( 1 );
+	}
+
+	if( cap_get( in, magic, sizeof( magic ) ) || memcmp( magic, cap_magic, sizeof( magic ) ) || cap_get( in, &version, sizeof( version ) ) || version != CAPTURE_VERSION )
+	{
+		fprintf( stderr, " Error: %s is not a CNEFinder capture of this version!\n", filename );
+		fclose( in );
+		return ( 1 );
+	}
+
+	if( cap_get( in, real, sizeof( real ) ) || cap_get( in, flags, sizeof( flags ) ) || cap_get( in, lengths, sizeof( lengths ) )
+	 || cap_get_string( in, &c->ref ) || cap_get_string( in, &c->query ) || cap_get( in, &count, sizeof( count ) ) )
+	{
+		fprintf( stderr, " Error: truncated capture %s!\n", filename );
+		fclose( in );
+		return ( 1 );
+	}
+
+	c->seeds . resize( count );
+	if( count && cap_get( in, c->seeds . data(), count * sizeof( MimOcc ) ) )
+	{
+		fprintf( stderr, " Error: truncated capture %s!\n", filename );
+		fclose( in );
+		return ( 1 );
+	}
+	fclose( in );
+
+	c->sw . t = real[0];
+	c->sw . s = real[1];
+	c->sw . M = real[2];
+	c->sw . p = flags[0];
+	c->sw . E = flags[1];
+	c->sw . l = lengths[0];
+	c->sw . u = lengths[1];
+
+return 0;
+}
+
+static int cap_put_string( FILE * out, const void * v, uint32_t len )
+{
+	return cap_put( out, &len, sizeof( len ) ) || ( len && cap_put( out, v, len ) );
+}
+
+static int cap_put_mask( FILE * out, vector<AnnInterval> * mask )
+{
+	uint32_t count = mask->size();
+
+	return cap_put( out, &count, sizeof( count ) ) || ( count && cap_put( out, mask->data(), count * sizeof( AnnInterval ) ) );
+}
+
+static int cap_get_mask( FILE * in, vector<AnnInterval> * mask )
+{
+	uint32_t count;
+
+	if( cap_get( in, &count, sizeof( count ) ) )
+		return ( 1 );
+
+	mask->resize( count );
+
+return count && cap_get( in, mask->data(), count * sizeof( AnnInterval ) );
+}
+
+/*
+A record holds one cnef call from its extracted regions on, for replaying the
+search in-process:
+
+	char[8]		"CNEFREC\0"
+	uint32		format version (RECORD_VERSION)
+	uint32		number of arguments, then each as length, characters
+	uint32, char[]	-o, which names the kind of call
+	double[3]	-t as 1 - similarity, -s, -M
+	int32[7]	-T, -x, -p, -u, -E, -O, -i
+	uint32[7]	-l, -v, -Q, -a, -b, -c, -d
+	uint32		q-gram size
+	uint32, char[]	reference chromosome as written to the output
+	uint32		reference start
+	uint32, char[]	query chromosome, the same way
+	uint32		query start
+	uint32, char[]	reference region, before masking
+	uint32, char[]	query region, forward strand
+	uint32, AnnInterval[]	reference mask
+	uint32, AnnInterval[]	query mask, forward strand
+
+Numbers are in the byte order of the machine that wrote the file.
+*/
+int record_write( const char * dir, int argc, char ** argv, TSwitch sw, unsigned int q_gram_size, unsigned char * ref, unsigned int ref_len, unsigned char * query, unsigned int query_len, SeqMasks * masks, const string & chrRef, unsigned int startRef, const string & chrQuery, unsigned int startQuery )
+{
+	/* Calls may run side by side, so each gets a file of its own */
+	string filename = string( dir ) + "/cnef-XXXXXX";
+	int fd = mkstemp( &filename[0] );
+	FILE * out;
+
+	if ( fd < 0 || ! ( out = fdopen ( fd, "wb" ) ) )
+	{
+		fprintf ( stderr, " Error: Cannot open file %s!\n", filename.c_str() );
+		if( fd >= 0 )
+			close( fd );
+		return ( 1 );
+	}
+
+	uint32_t version = RECORD_VERSION;
+	uint32_t args = argc;
+	double real[3] = { sw . t, sw . s, sw . M };
+	int32_t flags[7] = { sw . T, sw . x, sw . p, sw . u, sw . E, sw . O, sw . i };
+	uint32_t values[7] = { sw . l, sw . v, sw . Q, sw . a, sw . b, sw . c, sw . d };
+	uint32_t starts[2] = { startRef, startQuery };
+	uint32_t q = q_gram_size;
+	int err = cap_put( out, rec_magic, sizeof( rec_magic ) ) || cap_put( out, &version, sizeof( version ) ) || cap_put( out, &args, sizeof( args ) );
+
+	for( int i = 0; i < argc && ! err; i++ )
+		err = cap_put_string( out, argv[i], strlen( argv[i] ) );
+
+	if( err || cap_put_string( out, sw . output_filename, strlen( sw . output_filename ) )
+	 || cap_put( out, real, sizeof( real ) ) || cap_put( out, flags, sizeof( flags ) ) || cap_put( out, values, sizeof( values ) ) || cap_put( out, &q, sizeof( q ) )
+	 || cap_put_string( out, chrRef.data(), chrRef.size() ) || cap_put( out, &starts[0], sizeof( uint32_t ) ) || cap_put_string( out, chrQuery.data(), chrQuery.size() ) || cap_put( out, &starts[1], sizeof( uint32_t ) )
+	 || cap_put_string( out, ref, ref_len ) || cap_put_string( out, query, query_len ) || cap_put_mask( out, &masks->ref ) || cap_put_mask( out, &masks->query ) )
+	{
+		fprintf( stderr, " Error: Cannot write to file %s!\n", filename.c_str() );
+		fclose( out );
+		return ( 1 );
+	}
+
+	if ( fclose ( out ) )
+	{
+		fprintf( stderr, " Error: file close error!\n");
+		return ( 1 );
+	}
+
+return 0;
+}
+
+/*
+Loads a record; r->sw has no file names, -o is in r->output
+*/
+int record_read( const char * filename, Record * r )
+{
+	FILE * in;
+	char magic[8];
+	uint32_t version, args;
+	double real[3];
+	int32_t flags[7];
+	uint32_t values[7];
+	uint32_t q, starts[2];
+
+	if ( ! ( in = fopen ( filename, "rb" ) ) )
+	{
+		fprintf ( stderr, " Error: Cannot open file %s!\n", filename );
+		return ( 1 );
+	}
+
+	if( cap_get( in, magic, sizeof( magic ) ) || memcmp( magic, rec_magic, sizeof( magic ) ) || cap_get( in, &version, sizeof( version ) ) || version != RECORD_VERSION )
+	{
+		fprintf( stderr, " Error: %s is not a CNEFinder record of this version!\n", filename );
+		fclose( in );
+		return ( 1 );
+	}
+
+	int err = cap_get( in, &args, sizeof( args ) );
+
+	r->args . assign( err ? 0 : args, string() );
+	for( uint32_t i = 0; i < r->args.size() && ! err; i++ )
+		err = cap_get_string( in, &r->args[i] );
+
+	if( err || cap_get_string( in, &r->output ) || cap_get( in, real, sizeof( real ) ) || cap_get( in, flags, sizeof( flags ) ) || cap_get( in, values, sizeof( values ) ) || cap_get( in, &q, sizeof( q ) )
+	 || cap_get_string( in, &r->chrRef ) || cap_get( in, &starts[0], sizeof( uint32_t ) ) || cap_get_string( in, &r->chrQuery ) || cap_get( in, &starts[1], sizeof( uint32_t ) )
+	 || cap_get_string( in, &r->ref ) || cap_get_string( in, &r->query ) || cap_get_mask( in, &r->masks . ref ) || cap_get_mask( in, &r->masks . query ) )
+	{
+		fprintf( stderr, " Error: truncated record %s!\n", filename );
+		fclose( in );
+		return ( 1 );
+	}
+	fclose( in );
+
+	memset( &r->sw, 0, sizeof( r->sw ) );
+	r->sw . t = real[0];
+	r->sw . s = real[1];
+	r->sw . M = real[2];
+	r->sw . T = flags[0];
+	r->sw . x = flags[1];
+	r->sw . p = flags[2];
+	r->sw . u = flags[3];
+	r->sw . E = flags[4];
+	r->sw . O = flags[5];
+	r->sw . i = flags[6];
+	r->sw . l = values[0];
+	r->sw . v = values[1];
+	r->sw . Q = values[2];
+	r->sw . a = values[3];
+	r->sw . b = values[4];
+	r->sw . c = values[5];
+	r->sw . d = values[6];
+	r->q_gram_size = q;
+	r->startRef = starts[0];
+	r->startQuery = starts[1];
+
+return 0;
+}
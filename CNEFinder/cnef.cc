@@ -37,10 +37,6 @@ int main(int argc, char **argv)
 
 	FILE *          gen1_fd;                	 	
 	FILE *          gen2_fd;    
-	FILE *          ref_genes_fd;                	 	
-	FILE *          ref_exons_fd;   
-        FILE *          query_genes_fd;                	 	
-	FILE *          query_exons_fd;       	 	
 	FILE *          out_fd;                 	
         char *          genome_one_filename;          
 	char *          genome_two_filename;         
@@ -63,12 +59,6 @@ int main(int argc, char **argv)
         unsigned char ** seq_id_genome1 = NULL;     	// the sequences id in memory
 	unsigned char ** seq_id_genome2 = NULL;     	// the sequences id in memory
 
-	unsigned char ** ref_genes = NULL;     	
-	unsigned char ** ref_exons = NULL;   
-
-	unsigned char ** query_genes = NULL;     	
-	unsigned char ** query_exons = NULL;   
-
 	unsigned int    i, j;
 	unsigned int    q, l;
 
@@ -182,6 +172,10 @@ int main(int argc, char **argv)
 		return ( 1 );
 	}
 
+	stats_init( sw );
+	trace_init( sw );
+	stats_stage( STAGE_LOAD );
+
 	/* Read the FASTA file for genome one in memory */
 	fprintf ( stderr, " Reading the file: %s\n", genome_one_filename );
 	if ( ! ( gen1_fd = fopen (  genome_one_filename, "r") ) )
@@ -398,318 +392,31 @@ int main(int argc, char **argv)
 	/* Complete reading genome two */
 
 
-	/* Read the reference exons file */
-	fprintf ( stderr, " Reading the file: %s\n", ref_exons_filename );
-	if ( ! ( ref_exons_fd = fopen (  ref_exons_filename, "r") ) )
-	{
-		fprintf ( stderr, " Error: Cannot open file %s!\n",  ref_exons_filename  );
-		return ( 1 );
-	}
-
-	char ce;
-        unsigned int num_seqs_e = 0;    
-	unsigned int max_alloc_seq_e = 0;
-
-	do
-	{
-		if ( num_seqs_e >= max_alloc_seq_e )
-		{
-			ref_exons = ( unsigned char ** ) realloc ( ref_exons,   ( max_alloc_seq_e + ALLOC_SIZE ) * sizeof ( unsigned char * ) );
-			max_alloc_seq_e += ALLOC_SIZE;
-		}
-
-		unsigned int seq_len_e = 0;
-		unsigned int max_alloc_seq_len_e = 0;
-
-		ref_exons[ num_seqs_e ] = NULL;
-
-		while ( ( ce = fgetc( ref_exons_fd ) ) != EOF )
-		{
-			if( seq_len_e == 0 && ce == '\n' )
-			{
-				fprintf ( stderr, " Omitting empty line in file %s!\n",  ref_exons_filename );
-				ce = fgetc( ref_exons_fd );
-				break;
-			}
-
-			if( ce == '\n' )
-			{
-				break;
-			}
-			else
-			{
-
-				if ( seq_len_e >= max_alloc_seq_len_e )
-				{
-					ref_exons[ num_seqs_e ] = ( unsigned char * ) realloc ( ref_exons[ num_seqs_e ],   ( max_alloc_seq_len_e + ALLOC_SIZE ) * sizeof ( unsigned char ) );
-					max_alloc_seq_len_e += ALLOC_SIZE;
-				}
-
-
-				ref_exons[ num_seqs_e ][ seq_len_e++ ] = toupper( ce );
-			}
-	
-		}
-
-		if( seq_len_e != 0 )
-		{
-			if ( seq_len_e >= max_alloc_seq_len_e )
-			{
-				ref_exons[ num_seqs_e ] = ( unsigned char * ) realloc ( ref_exons[ num_seqs_e ],   ( max_alloc_seq_len_e + ALLOC_SIZE ) * sizeof ( unsigned char ) ); 
-				max_alloc_seq_len_e += ALLOC_SIZE;
-			}
-			ref_exons[ num_seqs_e ][ seq_len_e ] = '\0';
-			num_seqs_e++;
-		}
-		
-	} while( ce != EOF );
+	/* Index the annotation files */
+	AnnIndex ref_exons, query_exons, ref_genes, query_genes;
 
-
-	ref_exons[ num_seqs_e ] = NULL;
-
-	if ( fclose ( ref_exons_fd ) )
-	{
-		fprintf( stderr, " Error: file close error!\n");
+	fprintf ( stderr, " Reading the file: %s\n", ref_exons_filename );
+	if ( ann_index_exons( ref_exons_filename, &ref_exons, sw ) )
 		return ( 1 );
-	}
-	/* Complete reading referene exons file */
-
 
-	unsigned int num_seqs_g = 0;   
-	/* Read the reference genes file */
 	if( sw . ref_gene_name != NULL )
 	{
 		fprintf ( stderr, " Reading the file: %s\n", ref_genes_filename );
-		if ( ! ( ref_genes_fd = fopen (  ref_genes_filename, "r") ) )
-		{
-			fprintf ( stderr, " Error: Cannot open file %s!\n",  ref_genes_filename  );
-			return ( 1 );
-		}
-
-		char cg;
-		
-		unsigned int max_alloc_seq_g = 0;
-
-		do
-		{
-			if ( num_seqs_g >= max_alloc_seq_g )
-			{
-				ref_genes = ( unsigned char ** ) realloc ( ref_genes,   ( max_alloc_seq_g + ALLOC_SIZE ) * sizeof ( unsigned char * ) );
-				max_alloc_seq_g += ALLOC_SIZE;
-			}
-
-			unsigned int seq_len_g = 0;
-			unsigned int max_alloc_seq_len_g = 0;
-
-			ref_genes[ num_seqs_g ] = NULL;
-
-			while ( ( cg = fgetc( ref_genes_fd ) ) != EOF )
-			{
-				if( seq_len_g == 0 && cg == '\n' )
-				{
-					fprintf ( stderr, " Omitting empty line in file %s!\n",  ref_genes_filename );
-					cg = fgetc( ref_genes_fd );
-					break;
-				}
-
-				if( cg == '\n' )
-				{
-					break;	
-				}
-				else
-				{
-
-
-					if ( seq_len_g >= max_alloc_seq_len_g )
-					{
-						ref_genes[ num_seqs_g ] = ( unsigned char * ) realloc ( ref_genes[ num_seqs_g ],   ( max_alloc_seq_len_g + ALLOC_SIZE ) * sizeof ( unsigned char ) );
-						max_alloc_seq_len_g += ALLOC_SIZE;
-					}
-
-					ref_genes[ num_seqs_g ][ seq_len_g++ ] = toupper( cg );
-				}
-			}
-
-			if( seq_len_g != 0 )
-			{
-				if ( seq_len_g >= max_alloc_seq_len_g )
-				{
-					ref_genes[ num_seqs_g ] = ( unsigned char * ) realloc ( ref_genes[ num_seqs_g ],   ( max_alloc_seq_len_g + ALLOC_SIZE ) * sizeof ( unsigned char ) ); 
-					max_alloc_seq_len_g += ALLOC_SIZE;
-				}
-				ref_genes[ num_seqs_g ][ seq_len_g ] = '\0';
-
-				num_seqs_g++;
-			}
-		
-		} while( cg != EOF );
-
-
-		ref_genes[ num_seqs_g ] = NULL;
-
-		if ( fclose ( ref_genes_fd ) )
-		{
-			fprintf( stderr, " Error: file close error!\n");
+		if ( ann_index_genes( ref_genes_filename, &ref_genes, sw ) )
 			return ( 1 );
-		}
 	}
-	/* Complete reading reference genes file */
 
-	
-	/* Read the query exons file */
 	fprintf ( stderr, " Reading the file: %s\n", query_exons_filename );
-	if ( ! ( query_exons_fd = fopen (  query_exons_filename, "r") ) )
-	{
-		fprintf ( stderr, " Error: Cannot open file %s!\n",  query_exons_filename  );
+	if ( ann_index_exons( query_exons_filename, &query_exons, sw ) )
 		return ( 1 );
-	}
-
-	char cf;
-        unsigned int num_seqs_f = 0; 
-	unsigned int max_alloc_seq_f = 0;
-
-	do
-	{
-
-		if ( num_seqs_f >= max_alloc_seq_f )
-		{
-			query_exons = ( unsigned char ** ) realloc ( query_exons,   ( max_alloc_seq_f + ALLOC_SIZE ) * sizeof ( unsigned char * ) );
-			max_alloc_seq_f += ALLOC_SIZE;
-		}
-
-		unsigned int seq_len_f = 0;
-		unsigned int max_alloc_seq_len_f = 0;
-
-		query_exons[ num_seqs_f ] = NULL;
-
-		while ( ( cf = fgetc( query_exons_fd ) ) != EOF )
-		{
-			if( seq_len_f == 0 && cf == '\n' )
-			{
-				fprintf ( stderr, " Omitting empty line in file %s!\n", query_exons_filename );
-				cf = fgetc( query_exons_fd );
-				break;
-			}
-
-			if( cf == '\n' )
-			{
-				break;
-			}
-			else
-			{
-
-				if ( seq_len_f >= max_alloc_seq_len_f )
-				{
-					query_exons[ num_seqs_f ] = ( unsigned char * ) realloc ( query_exons[ num_seqs_f ],   ( max_alloc_seq_len_f + ALLOC_SIZE ) * sizeof ( unsigned char ) );
-					max_alloc_seq_len_f += ALLOC_SIZE;
-				}
-
-
-				query_exons[ num_seqs_f ][ seq_len_f++ ] = toupper ( cf );
-			}
-	
-		}
-
-		if( seq_len_f != 0 )
-		{
-			if ( seq_len_f >= max_alloc_seq_len_f )
-			{
-				query_exons[ num_seqs_f ] = ( unsigned char * ) realloc ( query_exons[ num_seqs_f ],   ( max_alloc_seq_len_f + ALLOC_SIZE ) * sizeof ( unsigned char ) ); 
-				max_alloc_seq_len_f += ALLOC_SIZE;
-			}
-			query_exons[ num_seqs_f ][ seq_len_f ] = '\0';
 
-			num_seqs_f++;
-		}
-		
-	} while( cf != EOF );
-
-
-	query_exons[ num_seqs_f ] = NULL;
-
-	if ( fclose ( query_exons_fd ) )
-	{
-		fprintf( stderr, " Error: file close error!\n");
-		return ( 1 );
-	}
-	/* Complete reading query exons file */
-
-	unsigned int num_seqs_j = 0; 
-	/* Read the query genes file */
 	if( sw . query_gene_name != NULL )
 	{
 		fprintf ( stderr, " Reading the file: %s\n", query_genes_filename );
-		if ( ! ( query_genes_fd = fopen (  query_genes_filename, "r") ) )
-		{
-			fprintf ( stderr, " Error: Cannot open file %s!\n",  query_genes_filename  );
+		if ( ann_index_genes( query_genes_filename, &query_genes, sw ) )
 			return ( 1 );
-		}
-
-		char cj;
-		      
-		unsigned int max_alloc_seq_j = 0;
-		do
-		{	if ( num_seqs_j >= max_alloc_seq_j )
-			{
-				query_genes = ( unsigned char ** ) realloc (query_genes,   ( max_alloc_seq_j + ALLOC_SIZE ) * sizeof ( unsigned char * ) );
-				max_alloc_seq_j += ALLOC_SIZE;
-			}
-
-			unsigned int seq_len_j = 0;
-			unsigned int max_alloc_seq_len_j = 0;
-
-			query_genes[ num_seqs_j ] = NULL;
-
-			while ( ( cj = fgetc( query_genes_fd ) ) != EOF )
-			{
-				if( seq_len_j == 0 && cj == '\n' )
-				{
-					fprintf ( stderr, " Omitting empty line in file %s!\n",  query_genes_filename );
-					cj = fgetc( query_genes_fd );
-					break;
-				}
-
-				if( cj == '\n' )
-				{
-					break;	
-				}
-				else
-				{
-
-
-					if ( seq_len_j >= max_alloc_seq_len_j )
-					{
-						query_genes[ num_seqs_j ] = ( unsigned char * ) realloc ( query_genes[ num_seqs_j ],   ( max_alloc_seq_len_j + ALLOC_SIZE ) * sizeof ( unsigned char ) );
-						max_alloc_seq_len_j += ALLOC_SIZE;
-					}
-
-					query_genes[ num_seqs_j ][ seq_len_j++ ] = toupper( cj );
-				}
-			}
-
-			if( seq_len_j != 0 )
-			{
-				if ( seq_len_j >= max_alloc_seq_len_j )
-				{
-					query_genes[ num_seqs_j ] = ( unsigned char * ) realloc ( query_genes[ num_seqs_j ],   ( max_alloc_seq_len_j + ALLOC_SIZE ) * sizeof ( unsigned char ) ); 
-					max_alloc_seq_len_j += ALLOC_SIZE;
-				}
-				query_genes[ num_seqs_j ][ seq_len_j ] = '\0';
-				num_seqs_j++;
-			}
-		
-		} while( cj != EOF );
-
-
-		query_genes[ num_seqs_j ] = NULL;
-
-		if ( fclose ( query_genes_fd ) )
-		{
-			fprintf( stderr, " Error: file close error!\n");
-			return ( 1 );
-		}
 	}
-	/* Complete reading query genes file */
+	/* Complete indexing the annotation files */
 
 
 	fprintf ( stderr, " Pre-processing data\n" );
@@ -736,8 +443,6 @@ int main(int argc, char **argv)
 	}
 
 	
-	int geneOnePos = 0;
-	int geneTwoPos = 0;
 
 	unsigned int q_gram_size =  max( sw . Q/1.0, sw . l /  ( ( sw . l - floor( sw . t * sw . l ) ) + 1 ) ) ;
 	sw . t = 1 - sw . t;
@@ -754,14 +459,9 @@ int main(int argc, char **argv)
 	unsigned int end_genome_2 = 0;
 	
 
-	vector<int> * exons_g1_start = new vector<int>;
-	vector<int> * exons_g1_end = new vector<int>;
-
-	
-	vector<int> * exons_g2_start = new vector<int>;
-	vector<int> * exons_g2_end = new vector<int>;
+	vector<AnnInterval> * exons_g1 = new vector<AnnInterval>;
+	vector<AnnInterval> * exons_g2 = new vector<AnnInterval>;
 
-	int countTabs = 0;
 	string chromosome_g1;
 	string chromosome_g1_nochr;
 	string refGeneName = to_string( sw . a );
@@ -777,52 +477,20 @@ int main(int argc, char **argv)
 		for (i=0; i<refGeneName.length(); i++)
 	    		refGeneName[i] = toupper( refGeneName[i] );
 
-		refGeneName.append( "\t" );
-
-		bool refGeneNameExists = false;
-		for(int i=0; i<num_seqs_g; i++)
-		{
-
-			if( prefix( reinterpret_cast<char*>(ref_genes[i]), refGeneName ) == true )
-			{
-				geneOnePos  = i;
-				refGeneNameExists = true;
-				break;
-			}	
-		}
+		AnnGene * gene = ann_find_gene( &ref_genes, refGeneName );
 
-		if( refGeneNameExists == false )
+		if( gene == NULL )
 		{
 			fprintf( stderr, " Error: Reference gene name does not exist!\n");
 			return ( 1 );
 		}
 
-		string startCoord_g1;
-		
-		string endCoord_g1;
-
-		for(int i=0; i<strlen( (char * ) ref_genes[geneOnePos] ); i++)
-		{
-			string in = reinterpret_cast<char*>( ref_genes[geneOnePos] );
-
-			if( ref_genes[geneOnePos][i] == '\t' )
-				countTabs++;
-			if( countTabs == 1 )
-				chromosome_g1 +=  toupper(in[i]) ;
-			if( countTabs == 2 )
-				startCoord_g1 += in[i] ;
-			if( countTabs == 3 )
-				endCoord_g1 += in[i] ;
-		}
-
-		trim( startCoord_g1 );
-		trim( endCoord_g1 );
-		trim(  chromosome_g1 );
-		start_genome_1 = atoi( startCoord_g1.c_str() );
+		chromosome_g1 = gene->chrom;
+		start_genome_1 = gene->start;
 		int diff = 0.05 * start_genome_1;
 		start_genome_1 = start_genome_1 - diff;
 
-		end_genome_1 = atoi( endCoord_g1.c_str() );
+		end_genome_1 = gene->end;
 		end_genome_1 = end_genome_1 + diff;
 
 		if( prefix( chromosome_g1 , "CHR" ) == false )
@@ -856,56 +524,21 @@ int main(int argc, char **argv)
 
 		for (i=0; i<queryGeneName.length(); i++)
 	    		queryGeneName[i] = toupper( queryGeneName[i] );
-		queryGeneName.append( "\t" );
 
-	
-		bool queryGeneNameExists = false;
-		for(int i=0; i<num_seqs_j; i++)
-		{
-		
-			if( prefix(  reinterpret_cast<char*>(  query_genes[i] ) , queryGeneName ) == true )
-			{
-				geneTwoPos  = i;
-				queryGeneNameExists = true;
-				break;
-			}
-		}
+		AnnGene * gene = ann_find_gene( &query_genes, queryGeneName );
 
-		if( queryGeneNameExists == false )
+		if( gene == NULL )
 		{
 			fprintf( stderr, " Error: Query gene name does not exist!\n");
 			return ( 1 );
 		}
 
-
-		countTabs = 0;
-		string startCoord_g2;
-		
-		string endCoord_g2;
-		for(int i=0; i<strlen( (char * ) query_genes[geneTwoPos] ); i++)
-		{
-
-			string in = reinterpret_cast<char*>(  query_genes[geneTwoPos] );
-			if( query_genes[geneTwoPos][i] == '\t' )
-				countTabs++;
-			if( countTabs == 1 )
-				chromosome_g2 += toupper(in[i]);
-			if( countTabs == 2 )
-				startCoord_g2 += in[i] ;
-			if( countTabs == 3 )
-				endCoord_g2 += in[i] ;
-		}
-
-		trim( startCoord_g2 );
-		trim( endCoord_g2 );
-		trim(  chromosome_g2 );
-	
-
-		start_genome_2 = atoi( startCoord_g2.c_str() );
+		chromosome_g2 = gene->chrom;
+		start_genome_2 = gene->start;
 		int diff = 0.05 * start_genome_2;
 		start_genome_2 = start_genome_2 - diff;
 
-		end_genome_2 = atoi( endCoord_g2.c_str() );
+		end_genome_2 = gene->end;
 		end_genome_2 = end_genome_2 + diff;
 		
 		if( prefix( chromosome_g2, "CHR" ) == false )
@@ -927,17 +560,6 @@ int main(int argc, char **argv)
 	to_upper( chromosome_g2 );
 	to_upper( chromosome_g2_nochr );
 
-	for ( i = 0; i < num_seqs_g; i ++ )
-	{
-		free ( ref_genes[i] );
-	}
-	for ( i = 0; i < num_seqs_j; i ++ )
-	{
-		free ( query_genes[i] );
-	}
-	free( ref_genes );
-	free( query_genes );
-
 	if( sw . a !=0 && start_genome_1 != sw . a )
 	{
 		fprintf( stderr, " Error: Start position for reference is different to that of gene\n. Search by either gene name or index position.\n  ");
@@ -977,121 +599,23 @@ int main(int argc, char **argv)
 	}
 	
 	//Obtaining exon coordinates
-	
 
-	for(int i=0; i<num_seqs_e; i++)
-	{
-		if( prefix( reinterpret_cast<char*>( ref_exons[i] ), chromosome_g1 ) == true ||  prefix( reinterpret_cast<char*>( ref_exons[i] ), chromosome_g1_nochr ) == true  )
-		{
-			countTabs = 0;
-			string c1 = "";
-			string c2 = "";
-
-			string in = reinterpret_cast<char*>( ref_exons[i] );
-			for(int j = 0; j<strlen( (char * ) ref_exons[i] ); j++)
-			{
-				if( ref_exons[i][j] == '\t' )
-					countTabs++;
-				if( countTabs == 1 )
-					c1 += in[j];
-				if( countTabs == 2 )
-					c2 += in[j] ;
-			}
-
-			trim( c1 );
-			trim( c2 );
-
-			for(int k = 0; k<c1.length(); k++)
-			{
-				if( !isdigit( c1[k] ) ) 
-				{	
-					fprintf( stderr, " Error: Reference exon file format is incorrect.\n"  );
-					return ( 1 );
-				}
-			}
-
-			for(int k=0; k<c2.length(); k++ )	
-			{
-				if( !isdigit(  c2[k] ) ) 
-				{
-					fprintf( stderr, " Error: Reference exon file format is incorrect.\n"  );
-					return ( 1 );
-				}
-			}
-
-			if( start_genome_1 > 0 && end_genome_1 > 0 )
-			{
-				if( ( !( atoi( c2.c_str() ) < start_genome_1 )  && !(atoi( c1.c_str() ) > end_genome_1) ) )
-				{
-					exons_g1_start->push_back( atoi( c1.c_str() ) );
-					exons_g1_end->push_back( atoi( c2.c_str() ) );
-				}
-			}
-			else
-			{
-				exons_g1_start->push_back( atoi( c1.c_str() ) );
-				exons_g1_end->push_back( atoi( c2.c_str() ) );
-
-			}
-		}
+	string key_g1 = chromosome_g1.substr( 0, chromosome_g1.length() - 1 );
+	string key_g1_nochr = chromosome_g1_nochr.substr( 0, chromosome_g1_nochr.length() - 1 );
 
+	if( ann_exons( &ref_exons, key_g1, start_genome_1, end_genome_1, exons_g1 ) || ann_exons( &ref_exons, key_g1_nochr, start_genome_1, end_genome_1, exons_g1 ) )
+	{
+		fprintf( stderr, " Error: Reference exon file format is incorrect.\n"  );
+		return ( 1 );
 	}
 
+	string key_g2 = chromosome_g2.substr( 0, chromosome_g2.length() - 1 );
+	string key_g2_nochr = chromosome_g2_nochr.substr( 0, chromosome_g2_nochr.length() - 1 );
 
-	for(int i=0; i<num_seqs_f; i++)
+	if( ann_exons( &query_exons, key_g2, start_genome_2, end_genome_2, exons_g2 ) || ann_exons( &query_exons, key_g2_nochr, start_genome_2, end_genome_2, exons_g2 ) )
 	{
-		if( prefix( reinterpret_cast<char*>(query_exons[i]), chromosome_g2 ) == true || prefix( reinterpret_cast<char*>( query_exons[i] ), chromosome_g2_nochr ) == true )
-		{	
-			countTabs = 0;
-			string c1;
-			string c2;
-			string in = reinterpret_cast<char*>(  query_exons[i] );
-
-			for(int j = 0; j<strlen( (char * ) query_exons[i] ); j++)
-			{
-				if( query_exons[i][j] == '\t' )
-					countTabs++;
-				if( countTabs == 1 )
-					c1 += in[j] ;
-				if( countTabs == 2 )
-					c2 += in[j] ;
-			}
-
-			trim( c1 );
-			trim( c2 );
-	
-			for(int k = 0; k<c1.length(); k++)
-			{
-				if( !isdigit( c1[k] ) )
-				{
-					fprintf( stderr, " Error: Query exon file format is incorrect.\n"  );
-					return ( 1 );
-				}
-			}
-
-			for(int k=0; k<c2.length(); k++ )	
-			{
-				if( !isdigit( c2[k] ) ) 
-				{
-					fprintf( stderr, " Error: Query exon file format is incorrect.\n"  );
-					return ( 1 );
-				}
-			}
-
-			if( start_genome_2 > 0 && end_genome_2 > 0 )
-			{
-				if( ( !( atoi( c2.c_str() ) < start_genome_2 )  && !(atoi( c1.c_str() ) > end_genome_2) ) )
-				{	
-					exons_g2_start->push_back( atoi( c1.c_str() ) );
-					exons_g2_end->push_back( atoi( c2.c_str() ) );
-				}
-			}
-			else
-			{
-				exons_g2_start->push_back( atoi( c1.c_str() ) );
-				exons_g2_end->push_back( atoi( c2.c_str() ) );
-			}
-		}
+		fprintf( stderr, " Error: Query exon file format is incorrect.\n"  );
+		return ( 1 );
 	}
 
 	//Obtain reference from genome1;
@@ -1152,13 +676,15 @@ int main(int argc, char **argv)
 	}
 
 
-	//remove all exons from reference 
-	string ref_str = reinterpret_cast<char*>(ref);
-	#pragma omp parallel for
-	for(int i=0; i<exons_g1_start->size(); i++)
-		ref_str.replace(exons_g1_start->at(i) - start_genome_1, exons_g1_end->at(i) - exons_g1_start->at(i),  exons_g1_end->at(i) - exons_g1_start->at(i), '$' );
-	
-	ref =  (unsigned char*) ref_str.c_str();
+	//mask the exons of the reference
+	stats_stage( STAGE_MASK );
+	SeqMasks masks;
+	unsigned int ref_len = end_genome_1 - start_genome_1;
+
+	mask_add_runs( ref, ref_len, &masks . ref );
+	mask_add_exons( exons_g1, start_genome_1, ref_len, &masks . ref );
+	mask_normalise( &masks . ref );
+	stats_stage( STAGE_LOAD );
 
 	//Obtain query from genome2
 	bool g2Chromosome = false;
@@ -1215,19 +741,17 @@ int main(int argc, char **argv)
 	}
 
 
-	//removing exons from query
-	string query_str = reinterpret_cast<char*>(query);
+	//mask the exons of the query
+	stats_stage( STAGE_MASK );
+	unsigned int query_len = end_genome_2 - start_genome_2;
 
-	#pragma omp parallel for
-	for(int i=0; i<exons_g2_start->size(); i++)
-		query_str.replace(exons_g2_start->at(i) - start_genome_2, exons_g2_end->at(i) - exons_g2_start->at(i),  exons_g2_end->at(i) - exons_g2_start->at(i), '$' );
+	mask_add_runs( query, query_len, &masks . query );
+	mask_add_exons( exons_g2, start_genome_2, query_len, &masks . query );
+	mask_normalise( &masks . query );
+	stats_stage( STAGE_LOAD );
 
-	query = (unsigned char*) query_str.c_str();
-
-	delete( exons_g1_start );
-	delete( exons_g1_end );
-	delete( exons_g2_start );
-	delete( exons_g2_end );
+	delete( exons_g1 );
+	delete( exons_g2 );
 
 	for ( i = 0; i < num_seqs; i ++ )
 	{
@@ -1239,122 +763,46 @@ int main(int argc, char **argv)
 		free ( genome2[i] );
 		free( seq_id_genome2[i] );
 	}
-	for ( i = 0; i < num_seqs_e; i ++ )
-	{
-		free ( ref_exons[i] );
-	}
-	for ( i = 0; i < num_seqs_f; i ++ )
-	{
-		free ( query_exons[i] );
-	}
 	free( genome1 );
 	free( genome2 );
 	free( seq_id_genome1 );
 	free( seq_id_genome2 );
-	free( ref_exons );
-	free( query_exons );
 	
 	fprintf ( stderr, " Computing CNEs with minimum length %i, maximum length %i and similarity threshold %.2f\% \n", sw . l, sw . u, 100.0-sw.t * 100.0 );
 
-	ofstream new_ref;
-	new_ref.open(string(sw.output_filename)+"_new_ref.fa");
-  	new_ref <<">"<<"new_ref_"+string(sw.output_filename)<<"\n"<<ref<<"\n";
-  	new_ref.close();  
+	for(int i=0; i<chromosome_g1.length(); i++)
+		chromosome_g1[i] = tolower( chromosome_g1[i] );
+	for(int i=0; i<chromosome_g2.length(); i++)
+		chromosome_g2[i] = tolower( chromosome_g2[i] );
+
+	trim( chromosome_g1 );
+	trim( chromosome_g2 );
 
-	ofstream new_query;
-	new_query.open(string(sw.output_filename)+"_new_query.fa");
-  	new_query <<">"<<"new_query_"+string(sw.output_filename)<<"\n"<<query<<"\n";
-  	new_query.close();  
+	/* CNEF_RECORD=<dir> keeps the extracted regions of each call, for bench/cnef-replay */
+	if( getenv( "CNEF_RECORD" ) )
+		record_write( getenv( "CNEF_RECORD" ), argc, argv, sw, q_gram_size, ref, ref_len, query, query_len, &masks, chromosome_g1, start_genome_1, chromosome_g2, start_genome_2 );
 
-	vector<QGramOcc> * q_grams = new vector<QGramOcc>;
 	vector<MimOcc> * mims = new vector<MimOcc>;
 
 	double start = gettime();
 
-	if( sw . v == 1 )
-	{
-		unsigned char * rc_seq = ( unsigned char * ) calloc ( ( strlen( ( char* ) query ) + 1 ) , sizeof( unsigned char ) );
-			
-		rev_complement( query, rc_seq , strlen( ( char* ) query ) );
-		rc_seq[  strlen( ( char* ) query ) ] = '\0';
-
-		find_maximal_exact_matches( q_gram_size , ref, rc_seq , q_grams, sw  );
-
-		if( q_grams->size() == 0 && sw . l == 4  )
-		{
-			fprintf( stderr, " Error: No CNEs found.\n" );
-			return ( 1 );
-		}
-		else if( q_grams->size() == 0  )
-		{
-			fprintf( stderr, " Error: No Matches found, try using a smaller value for minimum length.\n" );
-			return ( 1 );
-		}
-		find_maximal_inexact_matches( sw , ref, rc_seq, q_grams, mims, q_gram_size );
-
-		free( rc_seq );
-
-
-	}
-	else 
-	{
-		find_maximal_exact_matches( q_gram_size , ref, query , q_grams,  sw );
-
-		if( q_grams->size() == 0 && sw . l == 4  )
-		{
-			fprintf( stderr, " Error: No CNEs found.\n" );
-			return ( 1 );
-		}
-		else if( q_grams->size() == 0  )
-		{
-			fprintf( stderr, " Error: No Matches found, try using a smaller value for minimum length.\n" );
-			return ( 1 );
-		}
-
-		find_maximal_inexact_matches( sw , ref, query, q_grams, mims, q_gram_size );
-	}
-
-	if( sw . x == 1 )
-	{
-		remove_overlaps( mims, sw );
-
-	}
-
-	delete( q_grams );
+	if( find_cnes( sw, ref, ref_len, query, query_len, &masks, q_gram_size, mims ) )
+		return ( 1 );
 
 	fprintf ( stderr, " Preparing the output\n" );
 
-	if ( ! ( out_fd = fopen ( output_filename, "w") ) )
+	if ( ! ( out_fd = fopen ( output_filename, sw . O == OUT_BIN ? "wb" : "w" ) ) )
 	{
 		fprintf ( stderr, " Error: Cannot open file %s!\n", output_filename );
 		return ( 1 );
 	}
 
-	
-	for(int i=0; i<chromosome_g1.length(); i++)
-		chromosome_g1[i] = tolower( chromosome_g1[i] );
-	for(int i=0; i<chromosome_g2.length(); i++)
-		chromosome_g2[i] = tolower( chromosome_g2[i] );
-
-	trim( chromosome_g1 );
-	trim( chromosome_g2 );
-
-	//fprintf( out_fd, "%s%s%s%s%s%s%s\n", genome_one_filename, "\t", refGeneName.c_str(), "\t" , genome_two_filename,"\t", queryGeneName.c_str() );	
-	for ( int i = 0; i < mims->size(); i++ )
+	if ( write_cnes( out_fd, mims, sw, chromosome_g1, start_genome_1, chromosome_g2, start_genome_2 ) )
 	{
-		if ( mims->at(i).endQuery - mims->at(i).startQuery >= sw . l || mims->at(i).endRef - mims->at(i).startRef >= sw . l )
-		{
-
-			unsigned int minLen = min( mims->at(i).endQuery - mims->at(i).startQuery, mims->at(i).endRef - mims->at(i).startRef);
-
-			double threshold = (1.0 - (mims->at(i).error*1.0/minLen*1.0))*100.0;
-
-			fprintf( out_fd, "%s%s%i%s%i%s%s%s%i%s%i%s%i%s%i%s%.2f\n", chromosome_g1.c_str(), "\t", mims->at(i).startRef+start_genome_1, "\t", mims->at(i).endRef + start_genome_1, "\t" , chromosome_g2.c_str() , "\t", mims->at(i).startQuery+start_genome_2, "\t", mims->at(i).endQuery+start_genome_2, "\t", mims->at(i).endRef - mims->at(i).startRef, "\t", mims->at(i).endQuery - mims->at(i).startQuery  ,"\t", threshold );
-		}		
+		fprintf( stderr, " Error: Cannot write to file %s!\n", output_filename );
+		return ( 1 );
 	}
 
-
-
 	delete( mims );
 		
 	if ( fclose ( out_fd ) )
@@ -1366,10 +814,13 @@ int main(int argc, char **argv)
 
 	double end = gettime();
 
+	if ( stats_write( sw ) || trace_write( sw ) )
+		return ( 1 );
+
         fprintf( stderr, "Elapsed time: %lf secs.\n", end - start );
-	ref_str.clear();
+	free( ref );
 	free ( ref_id );
-	query_str.clear();
+	free( query );
 	free ( query_id );
         free ( sw . genome_one_filename );
 	free ( sw . genome_two_filename );
@@ -1382,31 +833,12 @@ int main(int argc, char **argv)
 	free ( sw . query_gene_name );
 	free ( sw . ref_chrom );
 	free ( sw . query_chrom );
+	free ( sw . stats_filename );
+	free ( sw . trace_filename );
 
 return 0;
 }
 
-unsigned int rev_complement( unsigned char * str, unsigned char * str2, int len )
-{
-	int i=0;
-	while ( len >= 0 )
-	{
-		if ( str[len] == 'A' )
-			str2[i++] = 'T';
-		else if( str[len] == 'C')
-			str2[i++] = 'G';
-		else if( str[len] == 'G')
-			str2[i++] = 'C';
-		else if( str[len] == 'T')
-			str2[i++] = 'A';
-		else if( str[len] == 'N')
-			str2[i++] = 'N';
-		len--;
-	}
-return 1;
-}
-
-
 bool prefix(string str, string pref)
 {
 	if( strncmp(str.c_str(), pref.c_str(), pref.length() ) == 0 )
@@ -16,8 +16,11 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **/
 
+#include <stdio.h>
+#include <stdint.h>
 #include <vector>
 #include <string>
+#include <unordered_map>
 #define INITIAL_SC		-100000
 #define ALLOC_SIZE               104857
 #define NA			'N'
@@ -28,6 +31,42 @@
 #define SUB			1
 #define MAT			0
 
+#define EXT_GREEDY		0
+#define EXT_XDROP		1
+#define EXT_WFA			2
+
+#define DNA_UNSUPPORTED		-2
+
+#define OUT_TEXT		0
+#define OUT_BIN			1
+#define CNE_BIN_VERSION		1
+#define CAPTURE_VERSION		1
+#define RECORD_VERSION		1
+
+#define STAGE_NONE		-1
+#define STAGE_LOAD		0
+#define STAGE_MASK		1
+#define STAGE_INDEX		2
+#define STAGE_SEED		3
+#define STAGE_DEDUP		4
+#define STAGE_MERGE		5
+#define STAGE_EXTEND		6
+#define STAGE_ADJUST		7
+#define STAGE_OVERLAPS		8
+#define STAGE_OUTPUT		9
+#define STAGES			10
+
+#define STAT_KMER_HITS		0
+#define STAT_MEMS		1
+#define STAT_CHAINS		2
+#define STAT_MYERS		3
+#define STAT_DP_CELLS		4
+#define STAT_CNES		5
+#define COUNTERS		6
+
+#define MERGE_LANES		8
+#define EXT_WAVE		1024
+
 #define MAX2(a,b) ((a) > (b)) ? (a) : (b)
 #define MIN2(a,b) ((a) < (b)) ? (a) : (b)  
 #define MAX3(a, b, c) ((a) > (b) ? ((a) > (c) ? (a) : (c)) : ((b) > (c) ? (b) : (c)))
@@ -47,12 +86,20 @@ struct TSwitch
    char               * query_gene_name;
    char               * ref_chrom;
    char               * query_chrom;
+   char               * stats_filename;
+   char               * trace_filename;
    double 		t, s, M;
-   int 			T, x, p, u;
+   int 			T, x, p, u, E, O, i;
    unsigned int         l, v, Q, a, b, c, d;
    
  };
 
+struct StatsTime
+ {
+   double		wall;
+   double		cpu;
+ };
+
 struct QGramOcc
  {
    unsigned int  occRef;
@@ -69,6 +116,90 @@ struct MimOcc
    unsigned int  error;
  };
 
+struct QGramTable
+ {
+   vector<unsigned int> occRef;
+   vector<unsigned int> occQuery;
+   vector<unsigned int> length;
+ };
+
+struct MimTable
+ {
+   vector<unsigned int> startRef;
+   vector<unsigned int> endRef;
+   vector<unsigned int> startQuery;
+   vector<unsigned int> endQuery;
+   vector<unsigned int> error;
+ };
+
+struct CneIndex
+ {
+   vector<MimOcc>       cnes;
+   unsigned int         maxLen;
+ };
+
+struct CneFile
+ {
+   string               chrRef;
+   string               chrQuery;
+   vector<MimOcc>       cnes;
+ };
+
+struct AnnInterval
+ {
+   unsigned int         start;
+   unsigned int         end;
+ };
+
+struct AnnChrom
+ {
+   vector<AnnInterval>  exons;
+   unsigned int         maxLen;
+   bool                 malformed;
+ };
+
+struct AnnGene
+ {
+   string               chrom;
+   int                  start, end;
+ };
+
+struct AnnIndex
+ {
+   int                  kind;
+   unordered_map<string, AnnChrom> chroms;
+   unordered_map<string, AnnGene> genes;
+ };
+
+struct Capture
+ {
+   TSwitch		sw;
+   string		ref;
+   string		query;
+   vector<MimOcc>	seeds;
+ };
+
+struct SeqMasks
+ {
+   vector<AnnInterval>  ref;
+   vector<AnnInterval>  query;
+ };
+
+struct Record
+ {
+   vector<string>	args;
+   string		output;
+   TSwitch		sw;
+   unsigned int		q_gram_size;
+   string		chrRef;
+   unsigned int		startRef;
+   string		chrQuery;
+   unsigned int		startQuery;
+   string		ref;
+   string		query;
+   SeqMasks		masks;
+ };
+
 struct PrevPos_L
  {
   unsigned int prev_L_ref;
@@ -81,21 +212,123 @@ struct PrevPos_R
   unsigned int prev_R_query;
  };
 
+struct ExtDP
+ {
+   unsigned char      * x;
+   unsigned char      * y;
+   int                  dir;
+   unsigned int         rows, cols;
+   vector<unsigned int> row;
+   vector<unsigned int> col;
+ };
+
+struct ExtProfile
+ {
+   vector<unsigned int> ref;
+   vector<unsigned int> query;
+ };
+
+struct EdPair
+ {
+   unsigned char      * x;
+   int                  n;
+   unsigned char      * y;
+   int                  m;
+   int                  k;
+   int                  score;
+ };
+
+struct MergeChain
+ {
+   unsigned int         current_qgram, j;
+   unsigned int         edit_distance;
+   unsigned int         q_start, q_end, r_start, r_end;
+   double               minLen, maxLen;
+   EdPair               gap;
+   bool                 waiting, done;
+ };
+
+struct EdlibBuffers;
+
+struct Workspace
+ {
+   unsigned char      * buf;
+   size_t               size;
+   size_t               used;
+   size_t               need;
+   vector<unsigned char *> spill;
+   ExtDP                dpL, dpR;
+   ExtProfile           profL, profR;
+   EdlibBuffers       * edlib;
+ };
+
 typedef int32_t INT;
 
 bool prefix(string str, string pref);
 int decode_switches ( int argc, char * argv [], struct TSwitch * sw );
 int remove_overlaps( vector<MimOcc> * mims, TSwitch sw );
+int write_cnes( FILE * out, vector<MimOcc> * mims, TSwitch sw, const string & chrRef, unsigned int startRef, const string & chrQuery, unsigned int startQuery );
+int write_cnes_text( FILE * out, vector<MimOcc> * cnes, const string & chrRef, const string & chrQuery );
+int write_cnes_bin( FILE * out, vector<MimOcc> * cnes, const string & chrRef, const string & chrQuery );
+int read_cnes_bin( FILE * in, CneFile * f );
+int ann_index_exons( const char * filename, AnnIndex * idx, TSwitch sw );
+int ann_index_genes( const char * filename, AnnIndex * idx, TSwitch sw );
+AnnGene * ann_find_gene( AnnIndex * idx, const string & name );
+int ann_exons( AnnIndex * idx, const string & chrom, unsigned int start, unsigned int end, vector<AnnInterval> * exons );
+void mask_normalise( vector<AnnInterval> * mask );
+void mask_add_runs( unsigned char * s, unsigned int len, vector<AnnInterval> * mask );
+void mask_add_exons( vector<AnnInterval> * exons, unsigned int offset, unsigned int len, vector<AnnInterval> * mask );
+bool mask_overlaps( vector<AnnInterval> * mask, unsigned int from, unsigned int to );
+void mask_apply( unsigned char * s, vector<AnnInterval> * mask );
+void mask_reverse( vector<AnnInterval> * mask, unsigned int len );
+void stats_init( TSwitch sw );
+void stats_stage( int stage );
+void stats_now( StatsTime * t );
+void stats_lap( StatsTime * sum, StatsTime * since );
+void stats_add( int stage, StatsTime * t );
+void stats_count( int counter, unsigned long long n );
+int stats_write( TSwitch sw );
+void trace_init( TSwitch sw );
+double trace_now( void );
+void trace_span( const char * name, double begin, double end, long long arg );
+void trace_long( const char * name, double begin, long long arg );
+int trace_write( TSwitch sw );
+int capture_write( const char * filename, TSwitch sw, unsigned char * ref, unsigned char * query, vector<MimOcc> * seeds );
+int capture_read( const char * filename, Capture * c );
+int record_write( const char * dir, int argc, char ** argv, TSwitch sw, unsigned int q_gram_size, unsigned char * ref, unsigned int ref_len, unsigned char * query, unsigned int query_len, SeqMasks * masks, const string & chrRef, unsigned int startRef, const string & chrQuery, unsigned int startQuery );
+int record_read( const char * filename, Record * r );
+int find_cnes( TSwitch sw, unsigned char * ref, unsigned int ref_len, unsigned char * query, unsigned int query_len, SeqMasks * masks, unsigned int q_gram_size, vector<MimOcc> * mims );
 double gettime ( void );
 void usage ( void );
 int alt_extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_start, int * r_end, unsigned char * xInput, unsigned char * yInput, TSwitch sw, int alt );
-int find_maximal_exact_matches( unsigned int l, unsigned char * ref, unsigned char * query, vector<QGramOcc> * q_grams, TSwitch sw );
-int editDistanceMyers( unsigned char * xInput, unsigned char * yInput );
-int merge( TSwitch sw, unsigned char * ref, unsigned char * query, vector<QGramOcc> * q_grams, vector<MimOcc> * mims );
-unsigned int rev_complement( unsigned char * str, unsigned char * str2, int iLen );
-int adjust( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_start, int * r_end, unsigned char * xInput, unsigned char * yInput, TSwitch sw );
-int find_maximal_inexact_matches( TSwitch sw, unsigned char * ref, unsigned char * query, vector<QGramOcc> * q_grams, vector<MimOcc> * mnms, unsigned int qgram_size );
-int extend( unsigned int * edit_distance,  int * q_start, int * q_end, int * r_start, int * r_end, unsigned char * xInput, unsigned char * yInput, TSwitch sw );
+int find_maximal_exact_matches( unsigned int l, unsigned char * ref, unsigned char * query, vector<QGramOcc> * q_grams, TSwitch sw, SeqMasks * masks );
+int editDistanceMyers( unsigned char * xInput, unsigned char * yInput, Workspace * ws );
+int editDistanceDNA( unsigned char * x, int n, unsigned char * y, int m, int k, Workspace * ws );
+int editDistanceBatch( EdPair * pairs, int count, Workspace * ws );
+unsigned int encode_bases( const unsigned char * s, unsigned int words, uint64_t * out );
+int editDistanceBounded( unsigned char * xInput, unsigned char * yInput, int k, Workspace * ws );
+int merge( TSwitch sw, unsigned char * ref, unsigned char * query, vector<QGramOcc> * q_grams, vector<MimOcc> * mims, SeqMasks * masks );
+unsigned int rev_complement( unsigned char * str, unsigned char * str2, unsigned int len );
+void rc_interval( unsigned int len, unsigned int * start, unsigned int * end );
+void rc_cnes( vector<MimOcc> * mims, unsigned int len );
+int adjust( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_start, int * r_end, unsigned char * xInput, unsigned char * yInput, TSwitch sw, Workspace * ws );
+int find_maximal_inexact_matches( TSwitch sw, unsigned char * ref, unsigned char * query, vector<QGramOcc> * q_grams, vector<MimOcc> * mnms, unsigned int qgram_size, SeqMasks * masks );
+int extend( unsigned int * edit_distance,  int * q_start, int * q_end, int * r_start, int * r_end, unsigned char * xInput, unsigned char * yInput, TSwitch sw, Workspace * ws );
+void ext_dp_init( ExtDP * dp, unsigned char * x, unsigned char * y, int dir );
+void ext_dp_grow( ExtDP * dp, unsigned int rows, unsigned int cols );
+int ext_dp_value( ExtDP * dp, unsigned int i, unsigned int j );
+int ext_dp_realign( unsigned char * x, unsigned int n, unsigned char * y, unsigned int m, Workspace * ws );
+int extend_bulk( unsigned int * edit_distance,  int * q_start, int * q_end, int * r_start, int * r_end, unsigned char * xInput, unsigned char * yInput, TSwitch sw, Workspace * ws );
+int xdrop_extend_side( unsigned char * a, int nA, unsigned char * b, int nB, double limit, double X, ExtProfile * prof, Workspace * ws );
+int wfa_extend_side( unsigned char * a, int nA, unsigned char * b, int nB, double limit, double X, ExtProfile * prof, Workspace * ws );
+void ws_init( Workspace * ws );
+void * ws_calloc( Workspace * ws, size_t n );
+void ws_reset( Workspace * ws );
+void ws_free( Workspace * ws );
+int editDistanceWFA( unsigned char * xInput, unsigned char * yInput, Workspace * ws );
+void ext_profile_add( ExtProfile * prof, unsigned int e, unsigned int i, unsigned int j );
+void ext_profile_monotone( ExtProfile * prof );
+int ext_profile_combine( ExtProfile * L, ExtProfile * R, unsigned int edit_distance, unsigned int lenRef, unsigned int lenQuery, TSwitch sw, unsigned int * eL, unsigned int * eR );
 bool order(MimOcc a, MimOcc b);
 unsigned int search( unsigned char * text, unsigned char * patt, unsigned int * score );
 double scoring( MimOcc , unsigned char * ref, unsigned char * query );
@@ -0,0 +1,62 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <string>
+#include "cnef.h"
+
+using namespace std;
+
+/*
+Prints a file written with --out-format bin as the text output of cnef
+*/
+int main( int argc, char ** argv )
+{
+	FILE * in_fd;
+	CneFile f;
+
+	if ( argc != 2 )
+	{
+		fprintf( stderr, " Usage: cnef-read <binary CNE file>\n" );
+		return ( 1 );
+	}
+
+	if ( ! ( in_fd = fopen ( argv[1], "rb" ) ) )
+	{
+		fprintf ( stderr, " Error: Cannot open file %s!\n", argv[1] );
+		return ( 1 );
+	}
+
+	if ( read_cnes_bin( in_fd, &f ) )
+	{
+		fclose( in_fd );
+		return ( 1 );
+	}
+
+	fclose( in_fd );
+
+	if ( write_cnes_text( stdout, &f.cnes, f.chrRef, f.chrQuery ) )
+	{
+		fprintf( stderr, " Error: Cannot write the output!\n" );
+		return ( 1 );
+	}
+
+return 0;
+}
@@ -0,0 +1,208 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "cnef.h"
+
+using namespace std;
+
+typedef uint64_t Word;
+
+#define DNA_STACK_BLOCKS	4
+
+/*
+Alphabets of the sequences cnef aligns: bases, N and the '$' mask, and the same
+with soft-masked lower case bases kept when repeats are not filtered (-p 0).
+code() gives the symbol of c, or -1 if c is not in the alphabet.
+*/
+struct DnaAlphabet
+ {
+   static const int SIZE = 6;
+
+   static inline int code( unsigned char c )
+   {
+	switch( c )
+	{
+		case 'A': return 0;
+		case 'C': return 1;
+		case 'G': return 2;
+		case 'T': return 3;
+		case 'N': return 4;
+		case DOL: return 5;
+		default: return -1;
+	}
+   }
+ };
+
+struct SoftMaskedDnaAlphabet
+ {
+   static const int SIZE = 11;
+
+   static inline int code( unsigned char c )
+   {
+	switch( c )
+	{
+		case 'A': return 0;
+		case 'C': return 1;
+		case 'G': return 2;
+		case 'T': return 3;
+		case 'N': return 4;
+		case DOL: return 5;
+		case 'a': return 6;
+		case 'c': return 7;
+		case 'g': return 8;
+		case 't': return 9;
+		case 'n': return 10;
+		default: return -1;
+	}
+   }
+ };
+
+/*
+Global (NW) edit distance of query q against target t with Myers' bit-parallel
+algorithm, one 64-bit word per block of the query and no alignment data. Returns
+the distance if it is at most k (any distance if k < 0), -1 if it is not, and
+DNA_UNSUPPORTED if a character is outside the alphabet.
+*/
+template <class Alphabet>
+static int dna_myers_nw( const unsigned char * q, int n, const unsigned char * t, int m, int k, Workspace * ws )
+{
+	for( int i = 0; i < n; i++ )
+		if( Alphabet::code( q[i] ) < 0 )
+			return DNA_UNSUPPORTED;
+	for( int j = 0; j < m; j++ )
+		if( Alphabet::code( t[j] ) < 0 )
+			return DNA_UNSUPPORTED;
+
+	int B = ( n + 63 ) / 64;
+	Word peqStack[Alphabet::SIZE * DNA_STACK_BLOCKS];
+	Word pvStack[DNA_STACK_BLOCKS];
+	Word mvStack[DNA_STACK_BLOCKS];
+	Word * Peq = peqStack;
+	Word * Pv = pvStack;
+	Word * Mv = mvStack;
+	size_t mark = 0;
+
+	if( B > DNA_STACK_BLOCKS )
+	{
+		if( ws == NULL )
+			return DNA_UNSUPPORTED;
+
+		mark = ws->used;
+		Peq = ( Word * ) ws_calloc( ws, Alphabet::SIZE * B * sizeof( Word ) );
+		Pv = ( Word * ) ws_calloc( ws, B * sizeof( Word ) );
+		Mv = ( Word * ) ws_calloc( ws, B * sizeof( Word ) );
+	}
+
+	/* Rows past the end of the query match everything, so they never lower the cells above them */
+	for( int s = 0; s < Alphabet::SIZE; s++ )
+		for( int b = 0; b < B; b++ )
+			Peq[s * B + b] = ( b == B - 1 && n % 64 ) ? ~( ( ( Word ) 1 << ( n % 64 ) ) - 1 ) : 0;
+	for( int i = 0; i < n; i++ )
+		Peq[Alphabet::code( q[i] ) * B + i / 64] |= ( Word ) 1 << ( i % 64 );
+
+	for( int b = 0; b < B; b++ )
+	{
+		Pv[b] = ~( Word ) 0;
+		Mv[b] = 0;
+	}
+
+	int lastBit = ( n - 1 ) % 64;
+	int score = n;
+
+	for( int j = 0; j < m; j++ )
+	{
+		const Word * Peq_c = Peq + Alphabet::code( t[j] ) * B;
+		int hin = 1;
+
+		for( int b = 0; b < B; b++ )
+		{
+			Word Eq = Peq_c[b];
+			Word P = Pv[b];
+			Word M = Mv[b];
+			Word hinIsNeg = ( Word ) ( hin < 0 );
+
+			Word Xv = Eq | M;
+			Eq |= hinIsNeg;
+			Word Xh = ( ( ( Eq & P ) + P ) ^ P ) | Eq;
+
+			Word Ph = M | ~( Xh | P );
+			Word Mh = P & Xh;
+
+			int bit = ( b == B - 1 ) ? lastBit : 63;
+			int hout = ( int ) ( ( Ph >> bit ) & 1 ) - ( int ) ( ( Mh >> bit ) & 1 );
+
+			Ph <<= 1;
+			Mh <<= 1;
+			Mh |= hinIsNeg;
+			Ph |= ( Word ) ( hin > 0 );
+
+			Pv[b] = Mh | ~( Xv | Ph );
+			Mv[b] = Ph & Xv;
+			hin = hout;
+		}
+
+		score += hin;
+
+		/* The last row can drop by at most one per remaining column */
+		if( k >= 0 && score - ( m - j - 1 ) > k )
+		{
+			score = -1;
+			break;
+		}
+	}
+
+	if( B > DNA_STACK_BLOCKS )
+		ws->used = mark;
+
+	if( k >= 0 && score > k )
+		score = -1;
+
+return score;
+}
+
+/*
+Edit distance of x[0..n) and y[0..m) with a kernel specialised for the DNA
+alphabets; the shorter sequence is packed into words. Returns DNA_UNSUPPORTED
+for other characters, so that the caller can fall back to edlib.
+*/
+int editDistanceDNA( unsigned char * x, int n, unsigned char * y, int m, int k, Workspace * ws )
+{
+	if( n == 0 || m == 0 )
+		return DNA_UNSUPPORTED;
+
+	if( k >= 0 && abs( n - m ) > k )
+		return -1;
+
+	if( n > m )
+	{
+		swap( x, y );
+		swap( n, m );
+	}
+
+	int score = dna_myers_nw<DnaAlphabet>( x, n, y, m, k, ws );
+
+	if( score == DNA_UNSUPPORTED )
+		score = dna_myers_nw<SoftMaskedDnaAlphabet>( x, n, y, m, k, ws );
+
+return score;
+}
@@ -0,0 +1,303 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "cnef.h"
+#include "edlib.h"
+
+using namespace std;
+
+typedef uint64_t Word;
+
+#define ED_LANES	4
+#define ED_SYMBOLS	11
+#define ED_UNSETTLED	-3
+
+/*
+Symbols of the lane kernel: the DNA alphabet with its soft-masked bases kept
+apart, as in editDistanceDNA(); 0xFF marks characters it does not handle
+*/
+struct EdCodes
+ {
+   unsigned char code[256];
+
+   EdCodes()
+   {
+	const char * symbols = "ACGTN$acgtn";
+
+	memset( code, 0xFF, sizeof( code ) );
+	for( int s = 0; s < ED_SYMBOLS; s++ )
+		code[( unsigned char ) symbols[s]] = s;
+   }
+ };
+
+static const unsigned char * ed_codes( void )
+{
+	static const EdCodes codes;
+
+return codes.code;
+}
+
+/*
+Distance of one pair on its own: the DNA kernel, or edlib for other characters
+*/
+static int ed_single( EdPair * p, Workspace * ws )
+{
+	int score = editDistanceDNA( p->x, p->n, p->y, p->m, p->k, ws );
+
+	if( score != DNA_UNSUPPORTED )
+		return score;
+
+	if( p->n == 0 || p->m == 0 )
+		return ( p->k < 0 || max( p->n, p->m ) <= p->k ) ? max( p->n, p->m ) : -1;
+
+	EdlibAlignResult result = edlibAlignWithBuffers( ( const char* ) p->x, p->n, ( const char* ) p->y, p->m, edlibNewAlignConfig( p->k, EDLIB_MODE_NW, EDLIB_TASK_DISTANCE ), ws ? ws->edlib : NULL );
+	score = result.editDistance;
+	edlibFreeAlignResult( result );
+
+return score;
+}
+
+/*
+Number of mismatching positions of x and y, both of length n, sixteen bytes at
+a time
+*/
+static int ed_hamming( const unsigned char * x, const unsigned char * y, int n )
+{
+	int h = 0;
+	int i = 0;
+
+#ifdef __SSE2__
+	for( ; i + 16 <= n; i += 16 )
+	{
+		__m128i eq = _mm_cmpeq_epi8( _mm_loadu_si128( ( __m128i * ) &x[i] ), _mm_loadu_si128( ( __m128i * ) &y[i] ) );
+		h += 16 - __builtin_popcount( _mm_movemask_epi8( eq ) );
+	}
+#endif
+	for( ; i < n; i++ )
+		h += ( x[i] != y[i] );
+
+return h;
+}
+
+/*
+Settles a pair from cheap bounds when it can. The distance is at least the
+length difference and at least half the difference of the symbol counts. It is
+at most the length difference plus the Hamming distance of the prefixes or of
+the suffixes of equal length, which for equal lengths is exact when it is 2 or
+less. Returns ED_UNSETTLED when the bounds leave the distance open.
+*/
+static int ed_bounds( EdPair * p, const unsigned char * code )
+{
+	int d = abs( p->n - p->m );
+	int s = min( p->n, p->m );
+	int lower = d;
+
+	if( p->k >= 0 && lower > p->k )
+		return -1;
+
+	int upper = d + ed_hamming( p->x, p->y, s );
+	if( d > 0 )
+		upper = min( upper, d + ed_hamming( &p->x[p->n - s], &p->y[p->m - s], s ) );
+
+	if( upper == lower || ( d == 0 && upper <= 2 ) )
+		return ( p->k < 0 || upper <= p->k ) ? upper : -1;
+
+	/* Characters outside the alphabet share one count, which keeps the bound valid */
+	int count[ED_SYMBOLS + 1] = { 0 };
+	for( int i = 0; i < p->n; i++ )
+		count[min( ( int ) code[p->x[i]], ED_SYMBOLS )]++;
+	for( int j = 0; j < p->m; j++ )
+		count[min( ( int ) code[p->y[j]], ED_SYMBOLS )]--;
+
+	int diff = 0;
+	for( int c = 0; c <= ED_SYMBOLS; c++ )
+		diff += abs( count[c] );
+	lower = max( lower, ( diff + 1 ) / 2 );
+
+	if( p->k >= 0 && lower > p->k )
+		return -1;
+
+	if( upper == lower )
+		return upper;
+
+return ED_UNSETTLED;
+}
+
+/*
+A pair fits a lane if its shorter sequence fits in one word and both are over
+the kernel alphabet
+*/
+static bool ed_lane_fits( EdPair * p, const unsigned char * code )
+{
+	int n = min( p->n, p->m );
+
+	if( n == 0 || n > 64 )
+		return false;
+
+	for( int i = 0; i < p->n; i++ )
+		if( code[p->x[i]] == 0xFF )
+			return false;
+	for( int j = 0; j < p->m; j++ )
+		if( code[p->y[j]] == 0xFF )
+			return false;
+
+return true;
+}
+
+#ifdef __x86_64__
+/*
+Myers' NW recurrence on up to four pairs at once, one 64-bit lane each. Lanes
+that have consumed their whole target keep their state through a blend, so pairs
+of different lengths share the same loop.
+*/
+__attribute__(( target( "avx2" ) ))
+static void ed_lanes_avx2( EdPair ** lane, int lanes, const unsigned char * code )
+{
+	Word peq[ED_LANES][ED_SYMBOLS];
+	const unsigned char * t[ED_LANES];
+	long long m[ED_LANES], last[ED_LANES], score0[ED_LANES];
+	int maxM = 0;
+
+	for( int l = 0; l < ED_LANES; l++ )
+	{
+		EdPair * p = lane[min( l, lanes - 1 )];
+		const unsigned char * q = ( p->n <= p->m ) ? p->x : p->y;
+		int n = min( p->n, p->m );
+
+		t[l] = ( p->n <= p->m ) ? p->y : p->x;
+		m[l] = max( p->n, p->m );
+		last[l] = ( long long ) ( ( Word ) 1 << ( n - 1 ) );
+		score0[l] = n;
+
+		/* Rows past the end of the query match everything */
+		for( int s = 0; s < ED_SYMBOLS; s++ )
+			peq[l][s] = ( n < 64 ) ? ~( ( ( Word ) 1 << n ) - 1 ) : 0;
+		for( int i = 0; i < n; i++ )
+			peq[l][code[q[i]]] |= ( Word ) 1 << i;
+
+		maxM = max( maxM, ( int ) m[l] );
+	}
+
+	__m256i ones = _mm256_set1_epi64x( -1 );
+	__m256i one = _mm256_set1_epi64x( 1 );
+	__m256i vm = _mm256_loadu_si256( ( __m256i * ) m );
+	__m256i vlast = _mm256_loadu_si256( ( __m256i * ) last );
+	__m256i score = _mm256_loadu_si256( ( __m256i * ) score0 );
+	__m256i Pv = ones;
+	__m256i Mv = _mm256_setzero_si256();
+
+	for( int j = 0; j < maxM; j++ )
+	{
+		__m256i Eq = _mm256_set_epi64x( peq[3][j < m[3] ? code[t[3][j]] : 0], peq[2][j < m[2] ? code[t[2][j]] : 0], peq[1][j < m[1] ? code[t[1][j]] : 0], peq[0][j < m[0] ? code[t[0][j]] : 0] );
+
+		__m256i Xv = _mm256_or_si256( Eq, Mv );
+		__m256i Xh = _mm256_or_si256( _mm256_xor_si256( _mm256_add_epi64( _mm256_and_si256( Eq, Pv ), Pv ), Pv ), Eq );
+		__m256i Ph = _mm256_or_si256( Mv, _mm256_xor_si256( _mm256_or_si256( Xh, Pv ), ones ) );
+		__m256i Mh = _mm256_and_si256( Pv, Xh );
+
+		__m256i hp = _mm256_cmpeq_epi64( _mm256_and_si256( Ph, vlast ), vlast );
+		__m256i hm = _mm256_cmpeq_epi64( _mm256_and_si256( Mh, vlast ), vlast );
+
+		Ph = _mm256_or_si256( _mm256_slli_epi64( Ph, 1 ), one );
+		Mh = _mm256_slli_epi64( Mh, 1 );
+
+		__m256i active = _mm256_cmpgt_epi64( vm, _mm256_set1_epi64x( j ) );
+
+		Pv = _mm256_blendv_epi8( Pv, _mm256_or_si256( Mh, _mm256_xor_si256( _mm256_or_si256( Xv, Ph ), ones ) ), active );
+		Mv = _mm256_blendv_epi8( Mv, _mm256_and_si256( Ph, Xv ), active );
+		score = _mm256_add_epi64( score, _mm256_and_si256( _mm256_sub_epi64( hm, hp ), active ) );
+	}
+
+	_mm256_storeu_si256( ( __m256i * ) score0, score );
+
+	for( int l = 0; l < lanes; l++ )
+		lane[l]->score = ( lane[l]->k < 0 || score0[l] <= lane[l]->k ) ? ( int ) score0[l] : -1;
+}
+#endif
+
+static bool order_lane( EdPair * a, EdPair * b )
+{
+	return max( a->n, a->m ) < max( b->n, b->m );
+}
+
+/*
+Edit distances of count independent pairs; pairs[i].score receives what
+editDistanceBounded() would give for them. Pairs that ed_bounds() cannot settle
+are aligned: short DNA pairs are grouped by target length and aligned four at a
+time on AVX2 processors; all other pairs, or every pair without AVX2, go one by
+one through the DNA kernel and edlib.
+*/
+int editDistanceBatch( EdPair * pairs, int count, Workspace * ws )
+{
+	const unsigned char * code = ed_codes();
+	bool simd = false;
+
+#ifdef __x86_64__
+	simd = __builtin_cpu_supports( "avx2" );
+#endif
+
+	size_t mark = ws->used;
+	EdPair ** lane = ( EdPair ** ) ws_calloc( ws, count * sizeof( EdPair * ) );
+	int lanes = 0;
+	unsigned long long cells = 0;
+
+	for( int i = 0; i < count; i++ )
+	{
+		EdPair * p = &pairs[i];
+
+		p->score = ed_bounds( p, code );
+
+		if( p->score != ED_UNSETTLED )
+			continue;
+
+		cells += ( unsigned long long ) p->n * p->m;
+
+		if( simd && ed_lane_fits( p, code ) )
+			lane[lanes++] = p;
+		else
+			p->score = ed_single( p, ws );
+	}
+
+#ifdef __x86_64__
+	if( lanes == 1 )
+		lane[0]->score = ed_single( lane[0], ws );
+	else if( lanes > 1 )
+	{
+		sort( lane, lane + lanes, order_lane );
+		for( int i = 0; i < lanes; i += ED_LANES )
+			ed_lanes_avx2( &lane[i], min( ED_LANES, lanes - i ), code );
+	}
+#endif
+
+	ws->used = mark;
+	stats_count( STAT_DP_CELLS, cells );
+
+return 0;
+}
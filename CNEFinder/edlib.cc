@@ -51,6 +51,14 @@ struct Block {
     Block(Word P, Word M, int score) :P(P), M(M), score(score) {}
 };
 
+// Scratch memory reused by edlibAlignWithBuffers() across calls.
+struct EdlibBuffers {
+    vector<unsigned char> query;
+    vector<unsigned char> target;
+    vector<Word> peq;
+    vector<Block> blocks;
+};
+
 static int myersCalcEditDistanceSemiGlobal(const Word* Peq, int W, int maxNumBlocks,
                                            const unsigned char* query,  int queryLength,
                                            const unsigned char* target, int targetLength,
@@ -62,7 +70,8 @@ static int myersCalcEditDistanceNW(const Word* Peq, int W, int maxNumBlocks,
                                    const unsigned char* target, int targetLength,
                                    int alphabetLength, int k, int* bestScore_,
                                    int* position_, bool findAlignment,
-                                   AlignmentData** alignData, int targetStopPosition);
+                                   AlignmentData** alignData, int targetStopPosition,
+                                   Block* blocksBuffer = NULL);
 
 
 static int obtainAlignment(
@@ -83,8 +92,8 @@ static int obtainAlignmentTraceback(int queryLength, int targetLength,
 
 static int transformSequences(const char* queryOriginal, int queryLength,
                               const char* targetOriginal, int targetLength,
-                              unsigned char** queryTransformed,
-                              unsigned char** targetTransformed);
+                              unsigned char* queryTransformed,
+                              unsigned char* targetTransformed);
 
 static inline int ceilDiv(int x, int y);
 
@@ -93,6 +102,9 @@ static inline unsigned char* createReverseCopy(const unsigned char* seq, int len
 static inline Word* buildPeq(int alphabetLength, const unsigned char* query,
                              int queryLength);
 
+static inline void fillPeq(Word* Peq, int alphabetLength, const unsigned char* query,
+                           int queryLength);
+
 
 
 /**
@@ -101,6 +113,20 @@ static inline Word* buildPeq(int alphabetLength, const unsigned char* query,
 extern "C" EdlibAlignResult edlibAlign(const char* const queryOriginal, const int queryLength,
                                        const char* const targetOriginal, const int targetLength,
                                        const EdlibAlignConfig config) {
+    return edlibAlignWithBuffers(queryOriginal, queryLength, targetOriginal, targetLength, config, NULL);
+}
+
+extern "C" EdlibBuffers* edlibNewBuffers(void) {
+    return new EdlibBuffers();
+}
+
+extern "C" void edlibFreeBuffers(EdlibBuffers* buffers) {
+    delete buffers;
+}
+
+extern "C" EdlibAlignResult edlibAlignWithBuffers(const char* const queryOriginal, const int queryLength,
+                                                  const char* const targetOriginal, const int targetLength,
+                                                  const EdlibAlignConfig config, EdlibBuffers* const buffers) {
     EdlibAlignResult result;
     result.editDistance = -1;
     result.endLocations = result.startLocations = NULL;
@@ -112,8 +138,17 @@ extern "C" EdlibAlignResult edlibAlign(const char* const queryOriginal, const in
 
     /*------------ TRANSFORM SEQUENCES AND RECOGNIZE ALPHABET -----------*/
     unsigned char* query, * target;
+    if (buffers) {
+        buffers->query.resize(max(queryLength, 1));
+        buffers->target.resize(max(targetLength, 1));
+        query = &buffers->query[0];
+        target = &buffers->target[0];
+    } else {
+        query = (unsigned char *) malloc(sizeof(unsigned char) * queryLength);
+        target = (unsigned char *) malloc(sizeof(unsigned char) * targetLength);
+    }
     int alphabetLength = transformSequences(queryOriginal, queryLength, targetOriginal, targetLength,
-                                            &query, &target);
+                                            query, target);
     result.alphabetLength = alphabetLength;
     /*-------------------------------------------------------*/
 
@@ -122,7 +157,17 @@ extern "C" EdlibAlignResult edlibAlign(const char* const queryOriginal, const in
     int maxNumBlocks = ceilDiv(queryLength, WORD_SIZE); // bmax in Myers
     int W = maxNumBlocks * WORD_SIZE - queryLength; // number of redundant cells in last level blocks
 
-    Word* Peq = buildPeq(alphabetLength, query, queryLength);
+    Word* Peq;
+    Block* blocks = NULL;
+    if (buffers) {
+        buffers->peq.resize((alphabetLength + 1) * max(maxNumBlocks, 1));
+        buffers->blocks.resize(max(maxNumBlocks, 1));
+        Peq = &buffers->peq[0];
+        blocks = &buffers->blocks[0];
+        fillPeq(Peq, alphabetLength, query, queryLength);
+    } else {
+        Peq = buildPeq(alphabetLength, query, queryLength);
+    }
     /*-------------------------------------------------------*/
 
 
@@ -147,7 +192,7 @@ extern "C" EdlibAlignResult edlibAlign(const char* const queryOriginal, const in
             myersCalcEditDistanceNW(Peq, W, maxNumBlocks,
                                     query, queryLength, target, targetLength,
                                     alphabetLength, k, &(result.editDistance), &positionNW,
-                                    false, &alignData, -1);
+                                    false, &alignData, -1, blocks);
         }
         k *= 2;
     } while(dynamicK && result.editDistance == -1);
@@ -211,13 +256,14 @@ extern "C" EdlibAlignResult edlibAlign(const char* const queryOriginal, const in
     /*-------------------------------------------------------*/
 
     //--- Free memory ---//
-    delete[] Peq;
-    free(query);
-    free(target);
+    if (!buffers) {
+        delete[] Peq;
+        free(query);
+        free(target);
+    }
     if (alignData) delete alignData;
     //-------------------//
 
-    free ( result.endLocations );
     return result;
 }
 
@@ -284,6 +330,16 @@ static inline Word* buildPeq(const int alphabetLength, const unsigned char* cons
     int maxNumBlocks = ceilDiv(queryLength, WORD_SIZE);
     // table of dimensions alphabetLength+1 x maxNumBlocks. Last symbol is wildcard.
     Word* Peq = new Word[(alphabetLength + 1) * maxNumBlocks];
+    fillPeq(Peq, alphabetLength, query, queryLength);
+    return Peq;
+}
+
+/**
+ * Fills Peq table built by buildPeq() into memory provided by the caller.
+ */
+static inline void fillPeq(Word* const Peq, const int alphabetLength, const unsigned char* const query,
+                           const int queryLength) {
+    int maxNumBlocks = ceilDiv(queryLength, WORD_SIZE);
 
     // Build Peq (1 is match, 0 is mismatch). NOTE: last column is wildcard(symbol that matches anything) with just 1s
     for (int symbol = 0; symbol <= alphabetLength; symbol++) {
@@ -302,7 +358,6 @@ static inline Word* buildPeq(const int alphabetLength, const unsigned char* cons
         }
     }
 
-    return Peq;
 }
 
 
@@ -660,7 +715,8 @@ static int myersCalcEditDistanceNW(const Word* const Peq, const int W, const int
                                    const unsigned char* const target, const int targetLength,
                                    const int alphabetLength, int k, int* const bestScore_,
                                    int* const position_, const bool findAlignment,
-                                   AlignmentData** const alignData, const int targetStopPosition) {
+                                   AlignmentData** const alignData, const int targetStopPosition,
+                                   Block* const blocksBuffer) {
     if (targetStopPosition > -1 && findAlignment) {
         // They can not be both set at the same time!
         return EDLIB_STATUS_ERROR;
@@ -683,7 +739,7 @@ static int myersCalcEditDistanceNW(const Word* const Peq, const int W, const int
     int lastBlock = min(maxNumBlocks, ceilDiv(min(k, (k + queryLength - targetLength) / 2) + 1, WORD_SIZE)) - 1;
     Block* bl; // Current block
 
-    Block* blocks = new Block[maxNumBlocks];
+    Block* blocks = blocksBuffer ? blocksBuffer : new Block[maxNumBlocks];
 
     // Initialize P, M and score
     bl = blocks;
@@ -804,7 +860,7 @@ static int myersCalcEditDistanceNW(const Word* const Peq, const int W, const int
         // If band stops to exist finish
         if (lastBlock < firstBlock) {
             *bestScore_ = *position_ = -1;
-            delete[] blocks;
+            if (!blocksBuffer) delete[] blocks;
             return EDLIB_STATUS_OK;
         }
         //------------------------------------------------------------------//
@@ -834,7 +890,7 @@ static int myersCalcEditDistanceNW(const Word* const Peq, const int W, const int
             }
             *bestScore_ = -1;
             *position_ = targetStopPosition;
-            delete[] blocks;
+            if (!blocksBuffer) delete[] blocks;
             return EDLIB_STATUS_OK;
         }
         //----------------------------------------------------//
@@ -848,13 +904,13 @@ static int myersCalcEditDistanceNW(const Word* const Peq, const int W, const int
         if (bestScore <= k) {
             *bestScore_ = bestScore;
             *position_ = targetLength - 1;
-            delete[] blocks;
+            if (!blocksBuffer) delete[] blocks;
             return EDLIB_STATUS_OK;
         }
     }
 
     *bestScore_ = *position_ = -1;
-    delete[] blocks;
+    if (!blocksBuffer) delete[] blocks;
     return EDLIB_STATUS_OK;
 }
 
@@ -1350,15 +1406,12 @@ static int obtainAlignmentHirschberg(
  */
 static int transformSequences(const char* const queryOriginal, const int queryLength,
                               const char* const targetOriginal, const int targetLength,
-                              unsigned char** const queryTransformed,
-                              unsigned char** const targetTransformed) {
+                              unsigned char* const queryTransformed,
+                              unsigned char* const targetTransformed) {
     // Alphabet is constructed from letters that are present in sequences.
     // Each letter is assigned an ordinal number, starting from 0 up to alphabetLength - 1,
     // and new query and target are created in which letters are replaced with their ordinal numbers.
     // This query and target are used in all the calculations later.
-    *queryTransformed = (unsigned char *) malloc(sizeof(unsigned char) * queryLength);
-    *targetTransformed = (unsigned char *) malloc(sizeof(unsigned char) * targetLength);
-
     // Alphabet information, it is constructed on fly while transforming sequences.
     unsigned char letterIdx[256]; //!< letterIdx[c] is index of letter c in alphabet
     bool inAlphabet[256]; // inAlphabet[c] is true if c is in alphabet
@@ -1372,7 +1425,7 @@ static int transformSequences(const char* const queryOriginal, const int queryLe
             letterIdx[c] = alphabetLength;
             alphabetLength++;
         }
-        (*queryTransformed)[i] = letterIdx[c];
+        queryTransformed[i] = letterIdx[c];
     }
     for (int i = 0; i < targetLength; i++) {
         unsigned char c = static_cast<unsigned char>(targetOriginal[i]);
@@ -1381,7 +1434,7 @@ static int transformSequences(const char* const queryOriginal, const int queryLe
             letterIdx[c] = alphabetLength;
             alphabetLength++;
         }
-        (*targetTransformed)[i] = letterIdx[c];
+        targetTransformed[i] = letterIdx[c];
     }
 
     return alphabetLength;
@@ -192,6 +192,25 @@ typedef enum {
                                 const EdlibAlignConfig config);
 
 
+    /**
+     * Scratch memory (transformed sequences, Peq table and blocks) that
+     * edlibAlignWithBuffers() keeps between calls, so that repeated alignments
+     * do not allocate. One object must not be shared between threads.
+     */
+    typedef struct EdlibBuffers EdlibBuffers;
+
+    EdlibBuffers* edlibNewBuffers(void);
+
+    void edlibFreeBuffers(EdlibBuffers* buffers);
+
+    /**
+     * Same as edlibAlign(), but takes its scratch memory from buffers when it is not NULL.
+     */
+    EdlibAlignResult edlibAlignWithBuffers(const char* query, int queryLength,
+                                           const char* target, int targetLength,
+                                           const EdlibAlignConfig config, EdlibBuffers* buffers);
+
+
     /**
      * Builds cigar string from given alignment sequence.
      * @param [in] alignment  Alignment sequence.
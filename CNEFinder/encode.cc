@@ -0,0 +1,185 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "cnef.h"
+
+#define ENC_WORD	32
+
+/*
+The 2-bit code of A, C, G and T, upper or lower case, is bits 1 and 2 of the
+ASCII character xor'ed with bits 2 and 3: A 0, C 1, G 2, T 3, as E-MEM packs them
+*/
+static inline int enc_valid( unsigned char c )
+{
+	c &= 0xDF;
+
+return c == 'A' || c == 'C' || c == 'G' || c == 'T';
+}
+
+/*
+Moves bit i of x to bit 2i
+*/
+static inline uint64_t enc_spread( uint64_t x )
+{
+	x = ( x | ( x << 16 ) ) & 0x0000FFFF0000FFFFULL;
+	x = ( x | ( x << 8 ) ) & 0x00FF00FF00FF00FFULL;
+	x = ( x | ( x << 4 ) ) & 0x0F0F0F0F0F0F0F0FULL;
+	x = ( x | ( x << 2 ) ) & 0x3333333333333333ULL;
+	x = ( x | ( x << 1 ) ) & 0x5555555555555555ULL;
+
+return x;
+}
+
+/*
+The word of 32 bases whose low and high code bits are the bits of lo and hi,
+base i in bit i; E-MEM keeps the first base in the two highest bits
+*/
+static inline uint64_t enc_pack( uint32_t lo, uint32_t hi )
+{
+	uint64_t w = enc_spread( lo ) | ( enc_spread( hi ) << 1 );
+
+	w = __builtin_bswap64( w );
+	w = ( ( w >> 4 ) & 0x0F0F0F0F0F0F0F0FULL ) | ( ( w & 0x0F0F0F0F0F0F0F0FULL ) << 4 );
+	w = ( ( w >> 2 ) & 0x3333333333333333ULL ) | ( ( w & 0x3333333333333333ULL ) << 2 );
+
+return w;
+}
+
+#ifndef __SSE2__
+static unsigned int enc_scalar( const unsigned char * s, unsigned int words, uint64_t * out )
+{
+	for( unsigned int k = 0; k < words; k++, s += ENC_WORD )
+	{
+		uint64_t w = 0;
+
+		for( int i = 0; i < ENC_WORD; i++ )
+		{
+			if( ! enc_valid( s[i] ) )
+				return k;
+			w = ( w << 2 ) | ( ( ( s[i] >> 1 ) ^ ( s[i] >> 2 ) ) & 3 );
+		}
+		out[k] = w;
+	}
+
+return words;
+}
+#endif
+
+#ifdef __SSE2__
+/*
+Sixteen bases per register. The 16-bit shifts carry bits in from the next byte,
+but only above the two code bits that are kept.
+*/
+static inline int enc_sse2( const unsigned char * s, uint32_t * lo, uint32_t * hi )
+{
+	const __m128i upper = _mm_set1_epi8( ( char ) 0xDF );
+	const __m128i three = _mm_set1_epi8( 3 );
+	__m128i c = _mm_loadu_si128( ( __m128i * ) s );
+	__m128i u = _mm_and_si128( c, upper );
+	__m128i ok = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( u, _mm_set1_epi8( 'A' ) ), _mm_cmpeq_epi8( u, _mm_set1_epi8( 'C' ) ) ),
+				   _mm_or_si128( _mm_cmpeq_epi8( u, _mm_set1_epi8( 'G' ) ), _mm_cmpeq_epi8( u, _mm_set1_epi8( 'T' ) ) ) );
+
+	if( _mm_movemask_epi8( ok ) != 0xFFFF )
+		return 0;
+
+	__m128i code = _mm_and_si128( _mm_xor_si128( _mm_srli_epi16( c, 1 ), _mm_srli_epi16( c, 2 ) ), three );
+
+	*lo = _mm_movemask_epi8( _mm_slli_epi16( code, 7 ) );
+	*hi = _mm_movemask_epi8( _mm_slli_epi16( code, 6 ) );
+
+return 1;
+}
+
+static unsigned int enc_words_sse2( const unsigned char * s, unsigned int words, uint64_t * out )
+{
+	for( unsigned int k = 0; k < words; k++, s += ENC_WORD )
+	{
+		uint32_t lo0, hi0, lo1, hi1;
+
+		if( ! enc_sse2( s, &lo0, &hi0 ) || ! enc_sse2( s + 16, &lo1, &hi1 ) )
+			return k;
+		out[k] = enc_pack( lo0 | ( lo1 << 16 ), hi0 | ( hi1 << 16 ) );
+	}
+
+return words;
+}
+#endif
+
+#ifdef __x86_64__
+/*
+A whole word of bases per register on AVX2 processors
+*/
+__attribute__(( target( "avx2" ) ))
+static unsigned int enc_words_avx2( const unsigned char * s, unsigned int words, uint64_t * out )
+{
+	const __m256i upper = _mm256_set1_epi8( ( char ) 0xDF );
+	const __m256i three = _mm256_set1_epi8( 3 );
+	const __m256i a = _mm256_set1_epi8( 'A' );
+	const __m256i c = _mm256_set1_epi8( 'C' );
+	const __m256i g = _mm256_set1_epi8( 'G' );
+	const __m256i t = _mm256_set1_epi8( 'T' );
+
+	for( unsigned int k = 0; k < words; k++, s += ENC_WORD )
+	{
+		__m256i x = _mm256_loadu_si256( ( __m256i * ) s );
+		__m256i u = _mm256_and_si256( x, upper );
+		__m256i ok = _mm256_or_si256( _mm256_or_si256( _mm256_cmpeq_epi8( u, a ), _mm256_cmpeq_epi8( u, c ) ),
+					      _mm256_or_si256( _mm256_cmpeq_epi8( u, g ), _mm256_cmpeq_epi8( u, t ) ) );
+
+		if( ( uint32_t ) _mm256_movemask_epi8( ok ) != 0xFFFFFFFFU )
+			return k;
+
+		__m256i code = _mm256_and_si256( _mm256_xor_si256( _mm256_srli_epi16( x, 1 ), _mm256_srli_epi16( x, 2 ) ), three );
+
+		out[k] = enc_pack( _mm256_movemask_epi8( _mm256_slli_epi16( code, 7 ) ), _mm256_movemask_epi8( _mm256_slli_epi16( code, 6 ) ) );
+	}
+
+return words;
+}
+#endif
+
+/*
+Packs words runs of 32 bases of s into out, two bits a base with the first base
+highest, and stops at the first run that holds anything but A, C, G or T in
+either case. Returns the number of runs packed; E-MEM encodes the rest, Ns and
+masked bases, one base at a time.
+*/
+unsigned int encode_bases( const unsigned char * s, unsigned int words, uint64_t * out )
+{
+#ifdef __x86_64__
+	static const bool avx2 = __builtin_cpu_supports( "avx2" );
+
+	if( avx2 )
+		return enc_words_avx2( s, words, out );
+#endif
+#ifdef __SSE2__
+	return enc_words_sse2( s, words, out );
+#else
+	return enc_scalar( s, words, out );
+#endif
+}
@@ -0,0 +1,319 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "cnef.h"
+
+using namespace std;
+
+/*
+Incremental edit distance matrix used by extend(). The matrix aligns the
+extension of the reference (rows) against the extension of the query (columns),
+both read away from the anchor in direction dir. Only its last row and last
+column are kept, which is all that is needed to grow it by one base at a time.
+*/
+static inline unsigned char ext_dp_char( unsigned char * s, int dir, unsigned int k )
+{
+	return ( dir > 0 ) ? s[k] : *( s - 1 - k );
+}
+
+void ext_dp_init( ExtDP * dp, unsigned char * x, unsigned char * y, int dir )
+{
+	dp->x = x;
+	dp->y = y;
+	dp->dir = dir;
+	dp->rows = 0;
+	dp->cols = 0;
+	dp->row.assign( 1, 0 );
+	dp->col.assign( 1, 0 );
+}
+
+static void ext_dp_add_row( ExtDP * dp )
+{
+	unsigned int r = dp->rows + 1;
+	unsigned char xc = ext_dp_char( dp->x, dp->dir, r - 1 );
+	unsigned int * row = &dp->row[0];
+
+	unsigned int diag = row[0];
+	row[0] = r;
+	for( unsigned int b = 1; b <= dp->cols; b++ )
+	{
+		unsigned int up = row[b];
+		unsigned int val = diag + ( xc != ext_dp_char( dp->y, dp->dir, b - 1 ) );
+
+		if( up + 1 < val )
+			val = up + 1;
+		if( row[b-1] + 1 < val )
+			val = row[b-1] + 1;
+
+		diag = up;
+		row[b] = val;
+	}
+
+	dp->col.push_back( row[dp->cols] );
+	dp->rows = r;
+}
+
+static void ext_dp_add_col( ExtDP * dp )
+{
+	unsigned int c = dp->cols + 1;
+	unsigned char yc = ext_dp_char( dp->y, dp->dir, c - 1 );
+	unsigned int * col = &dp->col[0];
+
+	unsigned int diag = col[0];
+	col[0] = c;
+	for( unsigned int a = 1; a <= dp->rows; a++ )
+	{
+		unsigned int left = col[a];
+		unsigned int val = diag + ( yc != ext_dp_char( dp->x, dp->dir, a - 1 ) );
+
+		if( left + 1 < val )
+			val = left + 1;
+		if( col[a-1] + 1 < val )
+			val = col[a-1] + 1;
+
+		diag = left;
+		col[a] = val;
+	}
+
+	dp->row.push_back( col[dp->rows] );
+	dp->cols = c;
+}
+
+/*
+Grows the matrix to rows x cols. Afterwards row[j] holds D[rows][j] and col[i]
+holds D[i][cols], so the S, I and D costs of extend() are col[rows],
+col[rows-1] and row[cols-1].
+*/
+void ext_dp_grow( ExtDP * dp, unsigned int rows, unsigned int cols )
+{
+	while( dp->rows < rows )
+		ext_dp_add_row( dp );
+
+	while( dp->cols < cols )
+		ext_dp_add_col( dp );
+}
+
+/*
+Edit distance of the first i reference and j query characters of the extension,
+growing the matrix to reach them. Returns -1 if the matrix already extends past
+both, as only its last row and column are kept.
+*/
+int ext_dp_value( ExtDP * dp, unsigned int i, unsigned int j )
+{
+	ext_dp_grow( dp, i, j );
+
+	if( dp->rows == i )
+		return dp->row[j];
+	if( dp->cols == j )
+		return dp->col[i];
+
+	return -1;
+}
+
+/*
+Edit distance of x[0..n) and y[0..m), for the cells ext_dp_value() cannot give
+*/
+int ext_dp_realign( unsigned char * x, unsigned int n, unsigned char * y, unsigned int m, Workspace * ws )
+{
+	size_t mark = ws->used;
+	unsigned char * A = ( unsigned char * ) ws_calloc( ws, n + 1 );
+	unsigned char * B = ( unsigned char * ) ws_calloc( ws, m + 1 );
+
+	memcpy( A, x, n );
+	memcpy( B, y, m );
+
+	int score = editDistanceMyers( A, B, ws );
+
+	ws->used = mark;
+
+	return score;
+}
+
+/*
+Copies at most maxLen characters of s, read away from the anchor in direction
+dir, stopping at the end of the sequence or at the first masked position.
+*/
+static unsigned int ext_copy( unsigned char * s, unsigned int avail, int dir, unsigned int maxLen, unsigned char ** out, Workspace * ws )
+{
+	unsigned int n = 0;
+	unsigned int lim = min( avail, maxLen );
+
+	*out = ( unsigned char * ) ws_calloc( ws, lim + 16 );
+	while( n < lim )
+	{
+		unsigned char c = ( dir > 0 ) ? s[n] : *( s - 1 - n );
+
+		if( c == DOL )
+			break;
+
+		( *out )[n] = c;
+		n++;
+	}
+
+	return n;
+}
+
+/*
+Records cell (i,j), reached with e errors and ending on a match, if it is
+further than the one kept for e so far.
+*/
+void ext_profile_add( ExtProfile * prof, unsigned int e, unsigned int i, unsigned int j )
+{
+	if( e >= prof->ref.size() )
+	{
+		prof->ref.resize( e + 1, 0 );
+		prof->query.resize( e + 1, 0 );
+	}
+
+	unsigned int m = min( prof->ref[e], prof->query[e] );
+
+	if( min( i, j ) > m || ( min( i, j ) == m && i + j > prof->ref[e] + prof->query[e] ) )
+	{
+		prof->ref[e] = i;
+		prof->query[e] = j;
+	}
+}
+
+/*
+Allowing more errors never shortens the best extension, so every entry of the
+profile is made at least as far as the one before it.
+*/
+void ext_profile_monotone( ExtProfile * prof )
+{
+	for( unsigned int e = 1; e < prof->ref.size(); e++ )
+	{
+		unsigned int m = min( prof->ref[e-1], prof->query[e-1] );
+
+		if( min( prof->ref[e], prof->query[e] ) < m || ( min( prof->ref[e], prof->query[e] ) == m && prof->ref[e] + prof->query[e] < prof->ref[e-1] + prof->query[e-1] ) )
+		{
+			prof->ref[e] = prof->ref[e-1];
+			prof->query[e] = prof->query[e-1];
+		}
+	}
+}
+
+/*
+Chooses how many errors to spend on each side of a match. As in extend(), the
+sides are explored up to the extension threshold but a result is only kept if
+its error ratio is within the similarity threshold; the longest such match that
+stays within the maximum CNE length wins.
+*/
+int ext_profile_combine( ExtProfile * L, ExtProfile * R, unsigned int edit_distance, unsigned int lenRef, unsigned int lenQuery, TSwitch sw, unsigned int * eL, unsigned int * eR )
+{
+	unsigned int best = min( lenRef, lenQuery );
+	unsigned int bestErr = 0;
+
+	*eL = 0;
+	*eR = 0;
+
+	for( unsigned int a = 0; a < L->ref.size(); a++ )
+	{
+		for( unsigned int b = 0; b < R->ref.size(); b++ )
+		{
+			unsigned int totRef = lenRef + L->ref[a] + R->ref[b];
+			unsigned int totQuery = lenQuery + L->query[a] + R->query[b];
+			unsigned int mn = min( totRef, totQuery );
+
+			if( max( totRef, totQuery ) > sw . u )
+				continue;
+
+			if( edit_distance + a + b > sw . t * mn )
+				continue;
+
+			if( mn > best || ( mn == best && a + b < bestErr ) )
+			{
+				best = mn;
+				bestErr = a + b;
+				*eL = a;
+				*eR = b;
+			}
+		}
+	}
+
+return 0;
+}
+
+/*
+Alternative to extend() used by the xdrop and wfa engines, and by adjust() in
+every mode: both sides are extended in bulk and the thresholds are applied once
+to the combined result.
+*/
+int extend_bulk( unsigned int * edit_distance, int * q_start, int * q_end, int * r_start, int * r_end, unsigned char * xInput, unsigned char * yInput, TSwitch sw, Workspace * ws )
+{
+	unsigned int qS = *q_start;
+	unsigned int rS = *r_start;
+	unsigned int qE = *q_end;
+	unsigned int rE = *r_end;
+
+	unsigned int xLen = strlen( ( char* ) xInput );
+	unsigned int yLen = strlen( ( char* ) yInput );
+
+	unsigned int lenRef = rE - rS;
+	unsigned int lenQuery = qE - qS;
+	unsigned int maxLen = max( lenRef, lenQuery );
+
+	if( maxLen >= sw . u )
+		return 0;
+
+	double limit = sw . t + sw . s;
+	double X = limit * sw . l;
+	unsigned int maxExt = sw . u - maxLen;
+
+	ExtProfile * profL = &ws->profL;
+	ExtProfile * profR = &ws->profR;
+
+	size_t mark = ws->used;
+	unsigned char * a;
+	unsigned char * b;
+	unsigned int nA = ext_copy( &xInput[rS], rS, -1, maxExt, &a, ws );
+	unsigned int nB = ext_copy( &yInput[qS], qS, -1, maxExt, &b, ws );
+
+	if( sw . E == EXT_WFA )
+		wfa_extend_side( a, nA, b, nB, limit, X, profL, ws );
+	else
+		xdrop_extend_side( a, nA, b, nB, limit, X, profL, ws );
+
+	ws->used = mark;
+	nA = ext_copy( &xInput[rE], xLen - rE, 1, maxExt, &a, ws );
+	nB = ext_copy( &yInput[qE], yLen - qE, 1, maxExt, &b, ws );
+
+	if( sw . E == EXT_WFA )
+		wfa_extend_side( a, nA, b, nB, limit, X, profR, ws );
+	else
+		xdrop_extend_side( a, nA, b, nB, limit, X, profR, ws );
+
+	ws->used = mark;
+
+	unsigned int eL;
+	unsigned int eR;
+
+	ext_profile_combine( profL, profR, *edit_distance, lenRef, lenQuery, sw, &eL, &eR );
+
+	*r_start = rS - profL->ref[eL];
+	*q_start = qS - profL->query[eL];
+	*r_end = rE + profR->ref[eR];
+	*q_end = qE + profR->query[eR];
+	*edit_distance = *edit_distance + eL + eR;
+
+return 0;
+}
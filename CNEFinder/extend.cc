@@ -30,6 +30,7 @@
 #include <omp.h>
 #include "cnef.h"
 #include "edlib.h"
+#include "radix.h"
 
 using namespace std;
 
@@ -44,6 +45,20 @@ bool order_qgram(QGramOcc a, QGramOcc b)
 
 }
 
+/*
+Packed ( occRef, occQuery ) and ( startRef, startQuery ) keys, which radix_sort()
+orders as order_qgram() and order() do
+*/
+static inline uint64_t qgram_key( const QGramOcc & a )
+{
+	return ( ( uint64_t ) a.occRef << 32 ) | a.occQuery;
+}
+
+static inline uint64_t mim_key( const MimOcc & a )
+{
+	return ( ( uint64_t ) a.startRef << 32 ) | a.startQuery;
+}
+
 bool order(MimOcc a, MimOcc b) 
 { 
 	
@@ -55,6 +70,20 @@ bool order(MimOcc a, MimOcc b)
 
 }
 
+bool order_error(MimOcc a, MimOcc b) 
+{ 
+	if( a.startRef != b.startRef )
+		return ( a.startRef < b.startRef );
+	if( a.startQuery != b.startQuery )
+		return ( a.startQuery < b.startQuery );
+	if( a.endRef != b.endRef )
+		return ( a.endRef < b.endRef );
+	if( a.endQuery != b.endQuery )
+		return ( a.endQuery < b.endQuery );
+
+	return ( a.error < b.error );
+}
+
 bool uniqueEnt(MimOcc a, MimOcc b) 
 {
 	if( a.startRef == b.startRef && a.endRef == b.endRef && a.startQuery == b.startQuery && a.endQuery == b.endQuery )
@@ -64,13 +93,134 @@ bool uniqueEnt(MimOcc a, MimOcc b)
 	else return false;
 }
 
-int find_maximal_inexact_matches( TSwitch sw, unsigned char * ref, unsigned char * query, vector<QGramOcc> * q_grams, vector<MimOcc> * mims, unsigned int qgram_size )
+/*
+Rough cost of extending each merged match: the room left before sw.u, weighted
+by the share of its error budget still unused. Matches that will not be
+extended cost nothing.
+*/
+static void extension_cost( MimTable * m, TSwitch sw, double * cost )
+{
+	const unsigned int * sR = m->startRef.data();
+	const unsigned int * eR = m->endRef.data();
+	const unsigned int * sQ = m->startQuery.data();
+	const unsigned int * eQ = m->endQuery.data();
+	const unsigned int * err = m->error.data();
+	int n = m->startRef.size();
+	double t = sw . t;
+	double u = sw . u;
+
+	for( int i = 0; i < n; i++ )
+	{
+		int lenRef = eR[i] - sR[i];
+		int lenQuery = eQ[i] - sQ[i];
+		double minLen = min( lenRef, lenQuery );
+		double maxLen = max( lenRef, lenQuery );
+		double e = ( int ) err[i];
+		double c = ( u - maxLen + 1 ) * ( 1 - e / ( t * minLen ) );
+
+		cost[i] = ( e / minLen < t && maxLen <= u ) ? c : 0;
+	}
+}
+
+/*
+Column copies of mims and back; mim_table_store() leaves out the matches marked
+in skip
+*/
+static void mim_table_load( MimTable * m, vector<MimOcc> * mims )
+{
+	unsigned int n = mims->size();
+
+	m->startRef.resize( n );
+	m->endRef.resize( n );
+	m->startQuery.resize( n );
+	m->endQuery.resize( n );
+	m->error.resize( n );
+
+	for( unsigned int i = 0; i < n; i++ )
+	{
+		m->startRef[i] = ( *mims )[i].startRef;
+		m->endRef[i] = ( *mims )[i].endRef;
+		m->startQuery[i] = ( *mims )[i].startQuery;
+		m->endQuery[i] = ( *mims )[i].endQuery;
+		m->error[i] = ( *mims )[i].error;
+	}
+}
+
+static MimOcc mim_table_row( MimTable * m, unsigned int i )
+{
+	MimOcc occ;
+
+	occ.startRef = m->startRef[i];
+	occ.endRef = m->endRef[i];
+	occ.startQuery = m->startQuery[i];
+	occ.endQuery = m->endQuery[i];
+	occ.error = m->error[i];
+
+return occ;
+}
+
+static void mim_table_store( MimTable * m, vector<char> * skip, vector<MimOcc> * mims )
+{
+	mims->clear();
+
+	for( unsigned int i = 0; i < m->startRef.size(); i++ )
+		if( ! ( *skip )[i] )
+			mims->push_back( mim_table_row( m, i ) );
+}
+
+/*
+Whether m lies inside one of the CNEs in index, which are sorted by startRef
+*/
+static bool cne_index_contains( CneIndex * index, MimOcc * m )
+{
+	unsigned int from = ( m->endRef > index->maxLen ) ? m->endRef - index->maxLen : 0;
+	MimOcc key;
+
+	key.startRef = from;
+	vector<MimOcc>::iterator it = lower_bound( index->cnes.begin(), index->cnes.end(), key, []( const MimOcc & a, const MimOcc & b ) { return a.startRef < b.startRef; } );
+
+	for( ; it != index->cnes.end() && it->startRef <= m->startRef; it++ )
+		if( it->endRef >= m->endRef && it->startQuery <= m->startQuery && it->endQuery >= m->endQuery )
+			return true;
+
+return false;
+}
+
+/*
+Adds the matches extended in one wave of the schedule to index, leaving out
+those too short to be reported
+*/
+static void cne_index_add( CneIndex * index, MimTable * m, int * schedule, int count, vector<char> * skip, TSwitch sw )
+{
+	size_t old = index->cnes.size();
+
+	for( int k = 0; k < count; k++ )
+	{
+		int i = schedule[k];
+
+		if( ( *skip )[i] )
+			continue;
+
+		if( m->endRef[i] - m->startRef[i] < sw . l && m->endQuery[i] - m->startQuery[i] < sw . l )
+			continue;
+
+		index->cnes.push_back( mim_table_row( m, i ) );
+		index->maxLen = max( index->maxLen, m->endRef[i] - m->startRef[i] );
+	}
+
+	sort( index->cnes.begin() + old, index->cnes.end(), order );
+	inplace_merge( index->cnes.begin(), index->cnes.begin() + old, index->cnes.end(), order );
+}
+
+int find_maximal_inexact_matches( TSwitch sw, unsigned char * ref, unsigned char * query, vector<QGramOcc> * q_grams, vector<MimOcc> * mims, unsigned int qgram_size, SeqMasks * masks )
 {
 
-	sort( q_grams->begin(), q_grams->end(), order_qgram );
+	stats_stage( STAGE_MERGE );
+	radix_sort( *q_grams, qgram_key );
 
 	fprintf ( stderr, " -Merging %i maximal exact matches\n", q_grams->size() );
-	merge( sw, ref, query, q_grams, mims );
+	merge( sw, ref, query, q_grams, mims, masks );
+	stats_count( STAT_CHAINS, mims->size() );
 
 	if( mims->size() == 0 )
 	{
@@ -83,21 +233,96 @@ int find_maximal_inexact_matches( TSwitch sw, unsigned char * ref, unsigned char
 	int merged_size = sw . M * sw . l;
 	fprintf ( stderr, " -Extending %i merged matches of minimum length %i, with an additional extension threshold of %.2f\n", mims->size(), merged_size, sw . s );
 
-	#pragma omp parallel for
-	for( int i=0; i<mims->size(); i++ )
-	{ 	
-		double minLen = min(mims->at(i).endRef-mims->at(i).startRef,mims->at(i).endQuery-mims->at(i).startQuery);
-		double maxLen = max(mims->at(i).endRef-mims->at(i).startRef,mims->at(i).endQuery-mims->at(i).startQuery);
+	stats_stage( STAGE_EXTEND );
+
+	/* Seeds merged to the same coordinates are extended once, from the one with the fewest errors */
+	sort( mims->begin(), mims->end(), order_error );
+	mims->erase( unique( mims->begin(), mims->end(), uniqueEnt ), mims->end() );
+
+	/* CNEF_CAPTURE=<file> saves what extension starts from, for bench/cnef-micro */
+	if( getenv( "CNEF_CAPTURE" ) )
+		capture_write( getenv( "CNEF_CAPTURE" ), sw, ref, query, mims );
+
+	/* The extension stage works on the matches column by column */
+	MimTable m;
+	mim_table_load( &m, mims );
+	int n = mims->size();
+
+	/* Matches are handed out one at a time, the most expensive looking first, so that no thread is left with a long tail */
+	vector<double> cost( n );
+	vector<int> schedule( n );
+	extension_cost( &m, sw, cost.data() );
+	for( int i=0; i<n; i++ )
+		schedule[i] = i;
+	stable_sort( schedule.begin(), schedule.end(), [&cost]( int a, int b ) { return cost[a] > cost[b]; } );
+
+	/*
+	Matches are extended in waves of EXT_WAVE. A match lying inside a CNE found
+	in an earlier wave is skipped; limiting this to earlier waves keeps the
+	output independent of the number of threads.
+	*/
+	CneIndex index;
+	index.maxLen = 0;
+	vector<char> skip( n, 0 );
+
+	#pragma omp parallel
+	{
+		/* Each thread reuses one workspace for all of its alignment buffers */
+		Workspace ws;
+		ws_init( &ws );
+		StatsTime adjusted = { 0, 0 }, t;
 
-		if( mims->at(i). error / minLen < sw . t && maxLen <= sw . u )
-		{	
-			extend( &mims->at(i).error, (int*) &mims->at(i).startQuery, (int*) &mims->at(i).endQuery, (int*) &mims->at(i).startRef, (int*) &mims->at(i).endRef, ref, query, sw );
-			adjust(  &mims->at(i).error, (int*) &mims->at(i).startQuery, (int*) &mims->at(i).endQuery, (int*) &mims->at(i).startRef, (int*) &mims->at(i).endRef, ref, query, sw );
+		for( int w=0; w<n; w+=EXT_WAVE )
+		{
+			int end = min( w + EXT_WAVE, n );
+
+			/* For the timeline: the share of this thread in the wave, up to the barrier */
+			double busy = trace_now(), done = 0;
+
+			#pragma omp for schedule( dynamic, 1 )
+			for( int k=w; k<end; k++ )
+			{ 	
+				int i = schedule[k];
+				MimOcc occ = mim_table_row( &m, i );
+				double began = trace_now();
+
+				done = began;
+
+				if( cne_index_contains( &index, &occ ) )
+				{
+					skip[i] = 1;
+					continue;
+				}
+
+				double minLen = min( occ.endRef - occ.startRef, occ.endQuery - occ.startQuery );
+				double maxLen = max( occ.endRef - occ.startRef, occ.endQuery - occ.startQuery );
+
+				if( occ.error / minLen < sw . t && maxLen <= sw . u )
+				{	
+					ws_reset( &ws );
+					extend( &m.error[i], (int*) &m.startQuery[i], (int*) &m.endQuery[i], (int*) &m.startRef[i], (int*) &m.endRef[i], ref, query, sw, &ws );
+					stats_now( &t );
+					adjust(  &m.error[i], (int*) &m.startQuery[i], (int*) &m.endQuery[i], (int*) &m.startRef[i], (int*) &m.endRef[i], ref, query, sw, &ws );
+					stats_lap( &adjusted, &t );
+					trace_long( "extension", began, i );
+					done = trace_now();
+				}
+			}
+
+			if( done > 0 )
+				trace_span( "extension wave", busy, done, w / EXT_WAVE );
+
+			#pragma omp single
+			cne_index_add( &index, &m, &schedule[w], end - w, &skip, sw );
 		}
-			
+
+		stats_add( STAGE_ADJUST, &adjusted );
+		ws_free( &ws );
 	}
 
-	sort( mims->begin(), mims->end(), order );
+	mim_table_store( &m, &skip, mims );
+
+	radix_sort( *mims, mim_key );
 
 
 	/* Remove overlapping CNEs */
@@ -142,182 +367,247 @@ int find_maximal_inexact_matches( TSwitch sw, unsigned char * ref, unsigned char
 return 0;
 }
 
-int merge( TSwitch sw, unsigned char * ref, unsigned char * query, vector<QGramOcc> * q_grams, vector<MimOcc> * mims )
+/*
+Starts the chain of matches merged from q_grams[i]
+*/
+static void merge_chain_init( MergeChain * c, QGramTable * q, unsigned int i )
 {
-	for( int i = 0; i<q_grams->size(); i++ )
-	{	
-		unsigned int current_qgram = i;	
-		unsigned int edit_distance = 0;
+	c->current_qgram = i;
+	c->j = i + 1;
+	c->edit_distance = 0;
 
-		unsigned int q_start = q_grams->at(i).occQuery;
-		unsigned int q_end = q_start + q_grams->at(i).length ;
-		unsigned int r_start = q_grams->at(i).occRef;
-		unsigned int r_end = r_start + q_grams->at(i).length ;
-		int gap_size_ref = 0;
-		int gap_size_query = 0;
+	c->q_start = q->occQuery[i];
+	c->q_end = c->q_start + q->length[i] ;
+	c->r_start = q->occRef[i];
+	c->r_end = c->r_start + q->length[i] ;
 
-		double minLen = min(r_end - r_start, q_end - q_start );
-		double maxLen = max(r_end - r_start, q_end - q_start );
+	c->minLen = min(c->r_end - c->r_start, c->q_end - c->q_start );
+	c->maxLen = max(c->r_end - c->r_start, c->q_end - c->q_start );
 
+	c->waiting = false;
+	c->done = false;
+}
 
-		for( int j = i + 1; j<q_grams->size(); j++ )
+/*
+Merges the matches following the chain until it ends or until a pair of gaps
+has to be aligned; the gaps are then left in c->gap, and the chain resumes from
+the same match once c->gap.score has been computed
+*/
+static bool merge_chain_run( TSwitch sw, unsigned char * ref, unsigned char * query, SeqMasks * masks, QGramTable * q, MergeChain * c )
+{
+	if( c->waiting )
+	{
+		int gap_distance = c->gap.score;
+		int edit_distance_temp = c->edit_distance + gap_distance;
+
+		c->waiting = false;
+
+		if( gap_distance >= 0 && edit_distance_temp/c->minLen <= sw.t  )
 		{
+			c->edit_distance = edit_distance_temp;
+			c->r_end = q->occRef[c->j] + q->length[c->j]; 
+			c->q_end = q->occQuery[c->j]  + q->length[c->j];
+
+			c->current_qgram = c->j;
+			c->minLen = min(c->r_end - c->r_start, c->q_end - c->q_start );
+			c->maxLen = max(c->r_end - c->r_start, c->q_end - c->q_start );
+		}
+
+		c->j++;
+	}
+
+	for( ; c->j<q->occRef.size(); c->j++ )
+	{
+		unsigned int j = c->j;
+		unsigned int current_qgram = c->current_qgram;
+
+		if( q->occRef[j] < q->occRef[current_qgram] )
+			continue;
+
+		if( c->maxLen >= sw . u )
+			break;
+
+		int gap_size_ref = 	q->occRef[j] - ( q->occRef[current_qgram] + q->length[current_qgram] ); 
+		int gap_size_query = q->occQuery[j] - ( q->occQuery[current_qgram] + q->length[current_qgram] );
 		
-			if( q_grams->at(j).occRef < q_grams->at(current_qgram).occRef )
-				continue;
 
-			if( maxLen >= sw . u )
-				break;
+		//Check if gap in ref or query contains $ 
+		bool ref$ = ( sw . p == 1 ) && mask_overlaps( &masks->ref, q->occRef[current_qgram] + q->length[current_qgram], q->occRef[j] );
+		bool query$ = ( sw . p == 1 ) && mask_overlaps( &masks->query, q->occQuery[current_qgram] + q->length[current_qgram], q->occQuery[j] );
 
-			gap_size_ref = 	q_grams->at(j).occRef - ( q_grams->at(current_qgram).occRef + q_grams->at(current_qgram).length ); 
-			gap_size_query = q_grams->at(j).occQuery - ( q_grams->at(current_qgram).occQuery + q_grams->at(current_qgram).length );
-			
 
-			//Check if gap in ref or query contains $ 
-			bool ref$ = false;
-			if( sw . p == 1 )
+		if(  q->occRef[j] + q->length[j] > c->r_end &&  q->occQuery[j] + q->length[j] > c->q_end )
+		{
+			c->minLen = min(q->occRef[j] + q->length[j] - c->r_start, q->occQuery[j]+ q->length[j] - c->q_start );
+			c->maxLen = max(q->occRef[j] + q->length[j] - c->r_start, q->occQuery[j]+ q->length[j] - c->q_start );
+		}
+
+		if( query$ == false && ref$ == false )
+		{
+			if( gap_size_ref == 0 && gap_size_query / c->minLen <= sw . t  && gap_size_query > 0 && c->maxLen <= sw . u  )
 			{
-				for(int k= q_grams->at(current_qgram).occRef + q_grams->at(current_qgram).length; k<q_grams->at(j).occRef; k++)
+				if( ( c->edit_distance + gap_size_query )/c->minLen  <= sw.t  )
 				{
-					if( ref[k] == '$' )
-					{
-						ref$ = true;
-						break;
-
-					}
-				}	
+					c->edit_distance = c->edit_distance + gap_size_query;
+					c->q_end = q->occQuery[j]+ q->length[j];
+					c->r_end =  q->occRef[j] + q->length[j];
+		
+					c->current_qgram = j;
+					c->minLen = min(c->r_end - c->r_start, c->q_end - c->q_start );
+					c->maxLen = max(c->r_end - c->r_start, c->q_end - c->q_start );
+				}
 			}
-			
-			bool query$ = false;
-			if( sw . p == 1 )
+			else if( gap_size_query == 0 && gap_size_ref/c->minLen <= sw.t && gap_size_ref > 0 && c->maxLen <= sw . u) 
 			{
-				for(int k= q_grams->at(current_qgram).occQuery + q_grams->at(current_qgram).length ; k<q_grams->at(j).occQuery ; k++)
+				if( (c->edit_distance + gap_size_ref)/c->minLen <= sw.t  )
 				{
-					if( query[k] == '$' )
-					{
-						query$ = true;
-						break;
-					}
+					c->edit_distance = c->edit_distance + gap_size_ref;
+					c->r_end = q->occRef[j]+ q->length[j];
+					c->q_end =  q->occQuery[j] + q->length[j]; 
+
+					c->current_qgram = j;
+					c->minLen = min(c->r_end - c->r_start, c->q_end - c->q_start );
+					c->maxLen = max(c->r_end - c->r_start, c->q_end - c->q_start );
 				}
 			}
+			else if( gap_size_query == 0 && gap_size_ref == 0  )
+			{	
+				c->r_end = q->occRef[j] + q->length[j];
+				c->q_end = q->occQuery[j] + q->length[j];
 
-
-			if(  q_grams->at(j).occRef + q_grams->at(j).length > r_end &&  q_grams->at(j).occQuery + q_grams->at(j).length > q_end )
-			{
-				minLen = min(q_grams->at(j).occRef + q_grams->at(j).length - r_start, q_grams->at(j).occQuery+ q_grams->at(j).length - q_start );
-				maxLen = max(q_grams->at(j).occRef + q_grams->at(j).length - r_start, q_grams->at(j).occQuery+ q_grams->at(j).length - q_start );
+				c->current_qgram = j;
+				c->minLen = min(c->r_end - c->r_start, c->q_end - c->q_start );
+				c->maxLen = max(c->r_end - c->r_start, c->q_end - c->q_start );
 			}
-			else 
+			else if ( gap_size_query > 0 && gap_size_ref > 0 && c->maxLen <= sw . u)
 			{	
-				maxLen = maxLen;
-				minLen = minLen;
-			}
+				if( abs( gap_size_query -  gap_size_ref ) / c->minLen > sw.t )
+					break;
 
-			if( query$ == false && ref$ == false )
-			{
-				if( gap_size_ref == 0 && gap_size_query / minLen <= sw . t  && gap_size_query > 0 && maxLen <= sw . u  )
+				/* Gaps whose distance cannot fit in the remaining error budget are rejected early */
+				int budget = ( int ) ( sw . t * c->minLen ) - ( int ) c->edit_distance + 1;
+
+				if( budget >= 0 )
 				{
-					if( ( edit_distance + gap_size_query )/minLen  <= sw.t  )
-					{
-						edit_distance = edit_distance + gap_size_query;
-						q_end = q_grams->at(j).occQuery+ q_grams->at(j).length;
-						r_end =  q_grams->at(j).occRef + q_grams->at(j).length;
-			
-						current_qgram = j;
-						minLen = min(r_end - r_start, q_end - q_start );
-						maxLen = max(r_end - r_start, q_end - q_start );
-					}
+					c->gap.x = &query[ c->q_end ];
+					c->gap.n = gap_size_query;
+					c->gap.y = &ref[ c->r_end ];
+					c->gap.m = gap_size_ref;
+					c->gap.k = budget;
+					c->waiting = true;
+
+					return true;
 				}
-				else if( gap_size_query == 0 && gap_size_ref/minLen <= sw.t && gap_size_ref > 0 && maxLen <= sw . u) 
-				{
-					if( (edit_distance + gap_size_ref)/minLen <= sw.t  )
-					{
-						edit_distance = edit_distance + gap_size_ref;
-						r_end = q_grams->at(j).occRef+ q_grams->at(j).length;
-						q_end =  q_grams->at(j).occQuery + q_grams->at(j).length; 
+			}	
+		}
+		else break;
+	}
 
-						current_qgram = j;
-						minLen = min(r_end - r_start, q_end - q_start );
-						maxLen = max(r_end - r_start, q_end - q_start );
-					}
-				}
-				else if( gap_size_query == 0 && gap_size_ref == 0  )
-				{	
-					r_end = q_grams->at(j).occRef + q_grams->at(j).length;
-					q_end = q_grams->at(j).occQuery + q_grams->at(j).length;
+	c->done = true;
 
-					current_qgram = j;
-					minLen = min(r_end - r_start, q_end - q_start );
-					maxLen = max(r_end - r_start, q_end - q_start );
-				}
-				else if ( gap_size_query > 0 && gap_size_ref > 0 && maxLen <= sw . u)
-				{	
-					if( abs( gap_size_query -  gap_size_ref ) / minLen > sw.t )
-						break;
-				
-					unsigned char * m_query = ( unsigned char * ) calloc ( gap_size_query + 1, sizeof ( unsigned char ) );
-					unsigned char * m_ref = ( unsigned char * ) calloc ( gap_size_ref + 1, sizeof ( unsigned char ) );
-			
-					memcpy( &m_query[0], &query[ q_end ], gap_size_query );
-					memcpy( &m_ref[0], &ref[ r_end ] , gap_size_ref );
+return false;
+}
 
-					m_query[ gap_size_query ] = '\0';
-					m_ref[ gap_size_ref ] = '\0';
-						
-					int edit_distance_temp = edit_distance + editDistanceMyers( m_query, m_ref );
+/*
+Merges the chains starting from MERGE_LANES consecutive matches side by side, so
+that the gaps they need aligned at the same time go to editDistanceBatch()
+together
+*/
+int merge( TSwitch sw, unsigned char * ref, unsigned char * query, vector<QGramOcc> * q_grams, vector<MimOcc> * mims, SeqMasks * masks )
+{
+	Workspace ws;
+	ws_init( &ws );
+
+	/* The chains read the matches column by column */
+	QGramTable q;
+	unsigned int n = q_grams->size();
+	q.occRef.resize( n );
+	q.occQuery.resize( n );
+	q.length.resize( n );
+	for( unsigned int i = 0; i < n; i++ )
+	{
+		q.occRef[i] = ( *q_grams )[i].occRef;
+		q.occQuery[i] = ( *q_grams )[i].occQuery;
+		q.length[i] = ( *q_grams )[i].length;
+	}
 
-					free( m_query );
-					free( m_ref );
+	MergeChain chain[MERGE_LANES];
+	EdPair pairs[MERGE_LANES];
+	int owner[MERGE_LANES];
 
-					if( edit_distance_temp/minLen <= sw.t  )
-					{
-						edit_distance = edit_distance_temp;
-						r_end = q_grams->at(j).occRef + q_grams->at(j).length; 
-						q_end = q_grams->at(j).occQuery  + q_grams->at(j).length;
-
-						current_qgram = j;
-						minLen = min(r_end - r_start, q_end - q_start );
-						maxLen = max(r_end - r_start, q_end - q_start );
-					}
-				}	
-			}
-			else break;
-		}
+	for( unsigned int i = 0; i<n; i += MERGE_LANES )
+	{	
+		ws_reset( &ws );
 
+		int lanes = min( ( unsigned int ) MERGE_LANES, n - i );
 
+		for( int l = 0; l < lanes; l++ )
+			merge_chain_init( &chain[l], &q, i + l );
 
-		bool longer = false;
+		int count;
+		do
+		{
+			count = 0;
+			for( int l = 0; l < lanes; l++ )
+			{
+				if( ! chain[l].done && merge_chain_run( sw, ref, query, masks, &q, &chain[l] ) )
+				{
+					pairs[count] = chain[l].gap;
+					owner[count++] = l;
+				}
+			}
 
-		if( r_end-r_start >= sw . M * sw . l && r_end - r_start <= sw . u && q_end-q_start >= sw . M * sw . l && q_end - q_start <= sw . u )	
-			longer = true;
+			editDistanceBatch( pairs, count, &ws );
 
-		//if( r_end - r_start > q_grams->at(i).length && q_end - q_start > q_grams->at(i).length )
-		//	longer = true;
-		
-		if ( r_end-r_start > sw . u && q_end - q_start > sw . u )
-		{
-			r_end = r_start + sw . l;
-			q_end = q_start + sw . l;
+			for( int p = 0; p < count; p++ )
+				chain[owner[p]].gap.score = pairs[p].score;
 		}
-		
-		if( max( r_end - r_start, q_end - q_start ) <= sw . u && longer == true )
+		while( count > 0 );
+
+		for( int l = 0; l < lanes; l++ )
 		{
-			MimOcc occ;
-			occ.startRef = r_start;
-			occ.endRef = r_end;
-			occ.startQuery = q_start;
-			occ.endQuery = q_end;
-			occ.error = edit_distance;
-			mims->push_back(occ);
-		}
+			unsigned int r_start = chain[l].r_start;
+			unsigned int r_end = chain[l].r_end;
+			unsigned int q_start = chain[l].q_start;
+			unsigned int q_end = chain[l].q_end;
+
+			bool longer = false;
+
+			if( r_end-r_start >= sw . M * sw . l && r_end - r_start <= sw . u && q_end-q_start >= sw . M * sw . l && q_end - q_start <= sw . u )	
+				longer = true;
 
+			//if( r_end - r_start > q_grams->at(i).length && q_end - q_start > q_grams->at(i).length )
+			//	longer = true;
+			
+			if ( r_end-r_start > sw . u && q_end - q_start > sw . u )
+			{
+				r_end = r_start + sw . l;
+				q_end = q_start + sw . l;
+			}
+			
+			if( max( r_end - r_start, q_end - q_start ) <= sw . u && longer == true )
+			{
+				MimOcc occ;
+				occ.startRef = r_start;
+				occ.endRef = r_end;
+				occ.startQuery = q_start;
+				occ.endQuery = q_end;
+				occ.error = chain[l].edit_distance;
+				mims->push_back(occ);
+			}
+		}
 	}
+
+	ws_free( &ws );
+
 	return 0;
 }
 
-
-int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_start, int * r_end, unsigned char * xInput, unsigned char * yInput, TSwitch sw )
+int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_start, int * r_end, unsigned char * xInput, unsigned char * yInput, TSwitch sw, Workspace * ws )
 {
+	if( sw . E != EXT_GREEDY )
+		return extend_bulk( edit_distance, q_start, q_end, r_start, r_end, xInput, yInput, sw, ws );
+
 	unsigned int toAddStartQuery = 1;
 	unsigned int toAddEndQuery = 1;
 	unsigned int toAddStartRef = 1;
@@ -355,7 +645,16 @@ int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_s
 	double minLen = min( q_end_temp - q_start_temp, r_end_temp - r_start_temp );
 	double maxLen = max(r_end_temp - r_start_temp, q_end_temp - q_start_temp );
 
-	while( q_start_temp >= 0 || r_start_temp >= 0 || q_end_temp <=  strlen( ( char* ) yInput ) -1 || r_end_temp <=  strlen( ( char* ) xInput ) )
+	unsigned int xLen = strlen( ( char* ) xInput );
+	unsigned int yLen = strlen( ( char* ) yInput );
+
+	/* Edit distances of the left and right extensions are advanced one base at a time */
+	ExtDP * dpR = &ws->dpR;
+	ExtDP * dpL = &ws->dpL;
+	ext_dp_init( dpR, &xInput[rE], &yInput[qE], 1 );
+	ext_dp_init( dpL, &xInput[rS], &yInput[qS], -1 );
+
+	while( q_start_temp >= 0 || r_start_temp >= 0 || q_end_temp <=  yLen -1 || r_end_temp <=  xLen )
 	{
 		if( maxLen >= sw . u  )
 			break;
@@ -370,13 +669,13 @@ int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_s
 		char dRref;
 		char dRquery;
 
-		unsigned int maxSeq = max(  strlen( ( char* ) yInput ),strlen( ( char* ) xInput ) );
+		unsigned int maxSeq = max(  yLen,xLen );
 
-		if (  q_end_temp  < strlen( ( char* ) yInput )  &&  r_end_temp  < strlen( ( char* ) xInput ) ) 
+		if (  q_end_temp  < yLen  &&  r_end_temp  < xLen ) 
 		{	
 			unsigned int editDist_S = 0;
-			unsigned char * m_ref_R  = ( unsigned char * ) calloc (  toAddEndRef + 1, sizeof ( unsigned char ) );
-			unsigned char * m_query_R  = ( unsigned char * ) calloc ( toAddEndQuery + 1, sizeof ( unsigned char ) );
+
+			ext_dp_grow( dpR, toAddEndRef, toAddEndQuery );
 
 			if( xInput[rE + toAddEndRef -1 ] == '$' || yInput[ qE + toAddEndQuery -1 ] == '$' )
 			{
@@ -384,15 +683,10 @@ int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_s
 			}
 			else
 			{
-				memcpy( &m_ref_R[0], &xInput[rE],  toAddEndRef  );
-				memcpy( &m_query_R[0], &yInput[qE],  toAddEndQuery  );
-				m_ref_R[ toAddEndRef ] = '\0';
-				m_query_R[ toAddEndQuery ] = '\0';
-
-				editDist_S = editDistanceMyers( m_ref_R, m_query_R );
+				editDist_S = dpR->col[ toAddEndRef ];
 
-				sRref = m_ref_R[toAddEndRef - 1];
-				sRquery = m_query_R[toAddEndQuery -1];
+				sRref = xInput[ rE + toAddEndRef - 1 ];
+				sRquery = yInput[ qE + toAddEndQuery - 1 ];
 			}
 				
 			unsigned int editDist_I = 0;
@@ -405,30 +699,20 @@ int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_s
 					editDist_I = maxSeq + 1;
 				else
 				{
-					memcpy( &m_ref_R[0], &xInput[rE],  toAddEndRef  );
-					memcpy( &m_query_R[0], &yInput[qE],  toAddEndQuery  );
-					m_ref_R[ toAddEndRef - 1 ] = '\0';
-					m_query_R[ toAddEndQuery ] = '\0';
-
-					editDist_I = editDistanceMyers( m_ref_R, m_query_R );
+					editDist_I = dpR->col[ toAddEndRef - 1 ];
 
-					iRref = m_ref_R[toAddEndRef - 2];
-					iRquery = m_query_R[toAddEndQuery -1];
+					iRref = xInput[ rE + toAddEndRef - 2 ];
+					iRquery = yInput[ qE + toAddEndQuery - 1 ];
 				}
 	
 				if( xInput[ rE + toAddEndRef - 1] == '$' )
 					editDist_D = maxSeq + 1;
 				else
 				{
-					memcpy( &m_ref_R[0], &xInput[rE],  toAddEndRef  );
-					memcpy( &m_query_R[0], &yInput[qE],  toAddEndQuery  );
-					m_ref_R[ toAddEndRef ] = '\0';
-					m_query_R[ toAddEndQuery - 1 ] = '\0';
+					editDist_D = dpR->row[ toAddEndQuery - 1 ];
 
-					editDist_D = editDistanceMyers( m_ref_R, m_query_R );
-
-					dRref = m_ref_R[toAddEndRef - 1];
-					dRquery = m_query_R[toAddEndQuery -2];
+					dRref = xInput[ rE + toAddEndRef - 1 ];
+					dRquery = ( toAddEndQuery > 1 ) ? yInput[ qE + toAddEndQuery - 2 ] : '\0';
 				}
 
 			}
@@ -480,11 +764,8 @@ int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_s
 				qec = dRquery;
 			}
 
-			free( m_ref_R );
-			free( m_query_R );
-
 		}
-		else if( qE == strlen( ( char* ) yInput ) && rE != strlen( ( char* ) xInput ) && r_end_temp < strlen( ( char* ) xInput )  )
+		else if( qE == yLen && rE != xLen && r_end_temp < xLen  )
 		{
 			if( xInput[ r_end_temp + 1] == '$' )
 				edit_distance_R = maxSeq + 1;
@@ -494,10 +775,10 @@ int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_s
 				operationEnd = 'D';
 
 				rec = xInput[ r_end_temp  ];
-				qec = yInput[ strlen( ( char* ) yInput ) - 1];
+				qec = yInput[ yLen - 1];
 			}
 		}
-		else if( rE == strlen( ( char* ) xInput ) && qE != strlen( ( char* ) yInput ) && q_end_temp < strlen( ( char* ) yInput ) )
+		else if( rE == xLen && qE != yLen && q_end_temp < yLen )
 		{
 			
 			if( yInput[ q_end_temp + 1] == '$' )
@@ -508,63 +789,45 @@ int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_s
 				operationEnd = 'I';
 
 				qec = yInput[ q_end_temp  ];
-				rec = xInput[ strlen( ( char* ) xInput ) - 1];
+				rec = xInput[ xLen - 1];
 			}
 		}
-		else if ( q_end_temp  < strlen( ( char* ) yInput ) && r_end_temp >= strlen( ( char* ) xInput ) )	
+		else if ( q_end_temp  < yLen && r_end_temp >= xLen )	
 		{
 		
 			if( yInput[ qE + toAddEndQuery  -1 ] == '$' )
 				edit_distance_R = maxSeq + 1;
 			else
 			{
-				unsigned char * m_ref_R = ( unsigned char * ) calloc (  toAddEndRef + 1, sizeof ( unsigned char ) );
-				unsigned char * m_query_R = ( unsigned char * ) calloc ( toAddEndQuery + 1, sizeof ( unsigned char ) );
-
-				memcpy( &m_ref_R[0], &xInput[rE],  strlen( ( char* ) xInput ) - rE );
-				memcpy( &m_query_R[0], &yInput[qE], toAddEndQuery  );
-				m_ref_R[ toAddEndRef ] = '\0';
-				m_query_R[ toAddEndQuery ] = '\0';
-		
-				edit_distance_R =  editDistanceMyers( m_ref_R, m_query_R );
+				edit_distance_R = ext_dp_value( dpR, xLen - rE, toAddEndQuery );
+				if( edit_distance_R < 0 )
+					edit_distance_R = ext_dp_realign( &xInput[rE], xLen - rE, &yInput[qE], toAddEndQuery, ws );
 				operationEnd = 'I';
 
-				rec = m_ref_R[ strlen( ( char* ) m_ref_R )  - 1];
-				qec = m_query_R[ toAddEndQuery - 1];
-
-				free( m_ref_R );
-				free( m_query_R );
+				rec = xInput[ xLen - 1 ];
+				qec = yInput[ qE + toAddEndQuery - 1 ];
 			}
 		}
-		else if ( q_end_temp  >= strlen( ( char* ) yInput ) - 1 && r_end_temp < strlen( ( char* ) xInput ) - 1 )	
+		else if ( q_end_temp  >= yLen - 1 && r_end_temp < xLen - 1 )	
 		{
 			if( xInput[ rE+toAddEndRef  -1 ] == '$' )
 				edit_distance_R = maxSeq + 1;
 			else
 			{
-				unsigned char * m_ref_R = ( unsigned char * ) calloc (  toAddEndRef + 1, sizeof ( unsigned char ) );
-				unsigned char * m_query_R = ( unsigned char * ) calloc ( toAddEndQuery + 1, sizeof ( unsigned char ) );
-
-				memcpy( &m_ref_R[0], &xInput[rE],  toAddEndRef );
-				memcpy( &m_query_R[0], &yInput[qE], strlen( ( char* ) yInput ) - qE   );
-				m_ref_R[ toAddEndRef ] = '\0';
-				m_query_R[ toAddEndQuery ] = '\0';
-		
-				edit_distance_R =  editDistanceMyers( m_ref_R, m_query_R );
+				edit_distance_R = ext_dp_value( dpR, toAddEndRef, yLen - qE );
+				if( edit_distance_R < 0 )
+					edit_distance_R = ext_dp_realign( &xInput[rE], toAddEndRef, &yInput[qE], yLen - qE, ws );
 				operationEnd = 'D';
 
-				rec = m_ref_R[ toAddEndRef - 1 ];
-				qec = m_query_R[  strlen( ( char* ) m_query_R )  - 1];
-
-				free( m_ref_R );
-				free( m_query_R );
+				rec = xInput[ rE + toAddEndRef - 1 ];
+				qec = yInput[ yLen - 1 ];
 			}
 		}
 		else 
 		{	
 			edit_distance_R = maxSeq + 1;
-			rec = xInput[ strlen( ( char * ) xInput ) - 1 ];
-			qec = yInput[ strlen( ( char * ) yInput ) - 1 ];
+			rec = xInput[ xLen - 1 ];
+			qec = yInput[ yLen - 1 ];
 
 		}
 
@@ -582,9 +845,8 @@ int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_s
 		if(  q_start_temp  > 0 &&  r_start_temp > 0   )  
 		{
 			unsigned int editDist_S;
-			unsigned char * m_ref_L = ( unsigned char * ) calloc ( toAddStartRef + 1, sizeof ( unsigned char ) );
-			unsigned char * m_query_L = ( unsigned char * ) calloc ( toAddStartQuery + 1, sizeof ( unsigned char ) );
-			
+
+			ext_dp_grow( dpL, toAddStartRef, toAddStartQuery );
 
 			if( xInput [rS - toAddStartRef] == '$' || yInput [qS - toAddStartQuery] == '$' )
 			{
@@ -592,16 +854,10 @@ int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_s
 			}	
 			else
 			{
+				editDist_S = dpL->col[ toAddStartRef ];
 
-				memcpy( &m_ref_L[0], &xInput [rS - toAddStartRef], toAddStartRef );
-				memcpy( &m_query_L[0], &yInput [qS - toAddStartQuery], toAddStartQuery );
-				m_ref_L[ toAddStartRef ] = '\0';
-				m_query_L[ toAddStartQuery ] = '\0';
-
-				editDist_S = editDistanceMyers( m_ref_L, m_query_L );
-
-				sLref = m_ref_L[0];
-				sLquery = m_query_L[0];
+				sLref = xInput[ rS - toAddStartRef ];
+				sLquery = yInput[ qS - toAddStartQuery ];
 			}
 
 			unsigned int editDist_I = 0;
@@ -615,15 +871,10 @@ int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_s
 				}
 				else
 				{
-					memcpy( &m_ref_L[0], &xInput [ rS - toAddStartRef + 1  ], toAddStartRef  );
-					memcpy( &m_query_L[0], &yInput [qS - toAddStartQuery], toAddStartQuery );
-					m_ref_L[ toAddStartRef - 1 ] = '\0';
-					m_query_L[ toAddStartQuery ] = '\0';
-					
-					editDist_I = editDistanceMyers( m_ref_L, m_query_L );
+					editDist_I = dpL->col[ toAddStartRef - 1 ];
 				
-					iLref = m_ref_L[0];
-					iLquery = m_query_L[0];
+					iLref = xInput[ rS - toAddStartRef + 1 ];
+					iLquery = yInput[ qS - toAddStartQuery ];
 				}
 
 
@@ -631,15 +882,10 @@ int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_s
 					editDist_D  = maxSeq +1;
 				else
 				{
-					memcpy( &m_ref_L[0], &xInput [rS - toAddStartRef], toAddStartRef );
-					memcpy( &m_query_L[0], &yInput [ qS - toAddStartQuery + 1 ], toAddStartQuery   );
-					m_ref_L[ toAddStartRef ] = '\0';
-					m_query_L[ toAddStartQuery - 1 ] = '\0';
-
-					editDist_D = editDistanceMyers( m_ref_L, m_query_L );
+					editDist_D = dpL->row[ toAddStartQuery - 1 ];
 	
-					dLref = m_ref_L[0];
-					dLquery = m_query_L[0];
+					dLref = xInput[ rS - toAddStartRef ];
+					dLquery = ( toAddStartQuery > 1 ) ? yInput[ qS - toAddStartQuery + 1 ] : '\0';
 				}
 			}
 			else
@@ -688,9 +934,6 @@ int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_s
 				qsc = dLquery;
 			}
 
-			free( m_ref_L );
-			free( m_query_L );
-
 		}
 		else if( qS == 0 && rS != 0 && r_start_temp > 0 )
 		{
@@ -730,22 +973,14 @@ int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_s
 			}
 			else
 			{
-				unsigned char * m_ref_L = ( unsigned char * ) calloc ( toAddStartRef + 1, sizeof ( unsigned char ) );
-				unsigned char * m_query_L = ( unsigned char * ) calloc ( toAddStartQuery + 1, sizeof ( unsigned char ) );
-				
-				memcpy( &m_ref_L[0], &xInput [rS - toAddStartRef], toAddStartRef );
-				memcpy( &m_query_L[0], &yInput [0], qS );
-				m_ref_L[ toAddStartRef ] = '\0';
-				m_query_L[ toAddStartQuery ] = '\0';
-			
-				edit_distance_L = editDistanceMyers( m_ref_L, m_query_L );
+				int value_L = ext_dp_value( dpL, toAddStartRef, qS );
+				if( value_L < 0 )
+					value_L = ext_dp_realign( &xInput[rS - toAddStartRef], toAddStartRef, &yInput[0], qS, ws );
+				edit_distance_L = value_L;
 				operationStart = 'D';
 
-				rsc = m_ref_L[0];
-				qsc = m_query_L[0];
-
-				free( m_ref_L );
-				free( m_query_L );
+				rsc = xInput[ rS - toAddStartRef ];
+				qsc = ( qS > 0 ) ? yInput[0] : '\0';
 			}
 
 		}
@@ -755,23 +990,14 @@ int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_s
 				edit_distance_L = maxSeq + 1;
 			else
 			{
-				unsigned char * m_ref_L = ( unsigned char * ) calloc ( toAddStartRef + 1, sizeof ( unsigned char ) );
-				unsigned char * m_query_L = ( unsigned char * ) calloc ( toAddStartQuery + 1, sizeof ( unsigned char ) );
-				
-				memcpy( &m_ref_L[0], &xInput [0], rS );
-				memcpy( &m_query_L[0], &yInput [qS - toAddStartQuery], toAddStartQuery );
-				m_ref_L[ toAddStartRef ] = '\0';
-				m_query_L[ toAddStartQuery ] = '\0';
-
-				edit_distance_L = editDistanceMyers( m_ref_L, m_query_L );
+				int value_L = ext_dp_value( dpL, rS, toAddStartQuery );
+				if( value_L < 0 )
+					value_L = ext_dp_realign( &xInput[0], rS, &yInput[qS - toAddStartQuery], toAddStartQuery, ws );
+				edit_distance_L = value_L;
 				operationStart = 'I';
 
-				rsc = m_ref_L[0];
-				qsc = m_query_L[0];
-
-				free( m_ref_L );
-				free( m_query_L );
-
+				rsc = ( rS > 0 ) ? xInput[0] : '\0';
+				qsc = yInput[ qS - toAddStartQuery ];
 			}
 		}
 		else 
@@ -1019,41 +1245,36 @@ int extend( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_s
 	*edit_distance = edit_distance_updated;
 
 	
-	if( qe > strlen( ( char* ) yInput ) )
-		*q_end =  strlen( ( char* ) yInput );
+	if( qe > yLen )
+		*q_end =  yLen;
 	else *q_end = qe;
 
-	if( re >  strlen( ( char* ) xInput ) )
-		*r_end = strlen( ( char* ) xInput );
+	if( re >  xLen )
+		*r_end = xLen;
 	else *r_end = re;
 	
 return 0;
 }
 
-int adjust( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_start, int * r_end, unsigned char * xInput, unsigned char * yInput, TSwitch sw )
+int adjust( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_start, int * r_end, unsigned char * xInput, unsigned char * yInput, TSwitch sw, Workspace * ws )
 {
 	unsigned int rS = *r_start;
 	unsigned int qS = *q_start;
 	unsigned int rE = *r_end;
 	unsigned int qE = *q_end;
 
-	unsigned int rSb = *r_start;
-	unsigned int rEb = *r_end;
-	unsigned int qSb = *q_start;
-	unsigned int qEb = *q_end;
-
-	unsigned char * A = ( unsigned char * ) calloc (  rE - rS + 1, sizeof ( unsigned char ) );
-	unsigned char * B = ( unsigned char * ) calloc ( qE - qS + 1, sizeof ( unsigned char ) );
+	size_t mark = ws->used;
+	unsigned char * A = ( unsigned char * ) ws_calloc( ws, rE - rS + 1 );
+	unsigned char * B = ( unsigned char * ) ws_calloc( ws, qE - qS + 1 );
 
 	memcpy( &A[0], &xInput[rS],  rE - rS  );
 	memcpy( &B[0], &yInput[qS],  qE - qS);
 	A[ rE - rS ] = '\0';
 	B[ qE- qS ] = '\0';
 		
-        *edit_distance = editDistanceMyers( A, B );
+        *edit_distance = ( sw . E == EXT_WFA ) ? editDistanceWFA( A, B, ws ) : editDistanceMyers( A, B, ws );
 
-	free( A );
-	free( B );
+	ws->used = mark;
 
 	
 	unsigned int minLen = min( rE - rS, qE - qS );
@@ -1063,56 +1284,28 @@ int adjust( unsigned int * edit_distance, int * q_start,  int * q_end, int * r_s
 	{
 		unsigned int eD = *edit_distance;
 
-		extend( ( unsigned int*) &eD, (int*) &qS, (int*) &qE, (int*) &rS, (int*) &rE,  xInput, yInput, sw );
-
-		*q_start = qS;
-		*q_end = qE;
-		*r_start = rS;
-		*r_end = rE;
-
-		unsigned char * A2 = ( unsigned char * ) calloc (  rE - rS + 1, sizeof ( unsigned char ) );
-		unsigned char * B2 = ( unsigned char * ) calloc ( qE - qS + 1, sizeof ( unsigned char ) );
-
-		memcpy( &A2[0], &xInput[rS],  rE - rS  );
-		memcpy( &B2[0], &yInput[qS],  qE - qS );
-		A2[ rE - rS ] = '\0';
-		B2[ qE- qS ] = '\0';
-		
-		*edit_distance =  editDistanceMyers( A2, B2 );
-
-		free( A2 );
-		free( B2 );
-
-	}
-
-	while( rSb != *r_start || rEb != *r_end || qSb != *q_start || qEb != *q_end )
-	{
-		unsigned int eD = *edit_distance;
-		
-		rSb = *r_start;
-		rEb = *r_end;
-		qSb = *q_start;
-		qEb = *q_end;
-
-		extend( ( unsigned int*) &eD, (int*) &qS, (int*) &qE, (int*) &rS, (int*) &rE,  xInput, yInput, sw );
+		/* Both boundaries are searched once with end-free alignments of the flanks, bounded by the maximum CNE length */
+		extend_bulk( ( unsigned int*) &eD, (int*) &qS, (int*) &qE, (int*) &rS, (int*) &rE,  xInput, yInput, sw, ws );
 
-		*q_start = qS;
-		*q_end = qE;
-		*r_start = rS;
-		*r_end = rE;
-
-		unsigned char * A2 = ( unsigned char * ) calloc (  rE - rS + 1, sizeof ( unsigned char ) );
-		unsigned char * B2 = ( unsigned char * ) calloc ( qE - qS + 1, sizeof ( unsigned char ) );
-
-		memcpy( &A2[0], &xInput[rS],  rE - rS  );
-		memcpy( &B2[0], &yInput[qS],  qE - qS );
-		A2[ rE - rS ] = '\0';
-		B2[ qE- qS ] = '\0';
+		if( rS != *r_start || rE != *r_end || qS != *q_start || qE != *q_end )
+		{
+			*q_start = qS;
+			*q_end = qE;
+			*r_start = rS;
+			*r_end = rE;
+
+			unsigned char * A2 = ( unsigned char * ) ws_calloc( ws, rE - rS + 1 );
+			unsigned char * B2 = ( unsigned char * ) ws_calloc( ws, qE - qS + 1 );
+
+			memcpy( &A2[0], &xInput[rS],  rE - rS  );
+			memcpy( &B2[0], &yInput[qS],  qE - qS );
+			A2[ rE - rS ] = '\0';
+			B2[ qE- qS ] = '\0';
 		
-		*edit_distance =  editDistanceMyers( A2, B2 );
+			*edit_distance = ( sw . E == EXT_WFA ) ? editDistanceWFA( A2, B2, ws ) : editDistanceMyers( A2, B2, ws );
 
-		free( A2 );
-		free( B2 );
+			ws->used = mark;
+		}
 	}
 	
 return 0;
@@ -1121,9 +1314,32 @@ return 0;
 /*
 Myers Bit-Vector algorithm implemented using edlib Library
 */
-int editDistanceMyers( unsigned char * xInput, unsigned char * yInput )
+int editDistanceMyers( unsigned char * xInput, unsigned char * yInput, Workspace * ws )
 {
-	unsigned int score = edlibAlign( (const char*) xInput, strlen( (char*) xInput ), (const char*) yInput, strlen( (char*) yInput ), edlibDefaultAlignConfig()).editDistance;
+	stats_count( STAT_MYERS, 1 );
+	return editDistanceBounded( xInput, yInput, -1, ws );
+}
+
+/*
+Edit distance of xInput and yInput if it is at most k, or -1 otherwise; edlib
+stops as soon as the band of distances within k is empty. A negative k gives the
+exact distance. DNA strings go through editDistanceDNA() instead of edlib
+*/
+int editDistanceBounded( unsigned char * xInput, unsigned char * yInput, int k, Workspace * ws )
+{
+	int n = strlen( (char*) xInput );
+	int m = strlen( (char*) yInput );
+	int score = editDistanceDNA( xInput, n, yInput, m, k, ws );
+
+	stats_count( STAT_DP_CELLS, ( unsigned long long ) n * m );
+
+	if( score != DNA_UNSUPPORTED )
+		return score;
+
+	EdlibAlignResult result = edlibAlignWithBuffers( (const char*) xInput, n, (const char*) yInput, m, edlibNewAlignConfig( k, EDLIB_MODE_NW, EDLIB_TASK_DISTANCE ), ws ? ws->edlib : NULL );
+	score = result.editDistance;
+
+	edlibFreeAlignResult( result );
 
 	return score;
 }
@@ -91,6 +91,88 @@ class mapObject {
       }
 };
 
+/*
+ * Bitmap of the N (and masked) bases of a chunk, one bit per base, with
+ * the first N at or after the start of each word and the last N at or
+ * before its end, so that both neighbours of a position are found with
+ * a couple of word operations.
+ */
+class nBitmap {
+      vector<uint64_t> bits;
+      vector<uint64_t> nextN;
+      vector<uint64_t> prevN;
+
+    public:
+      static const uint64_t none = ~(uint64_t)0;
+
+      void clear()
+      {
+          bits.clear();
+          nextN.clear();
+          prevN.clear();
+      }
+
+      bool empty()
+      {
+          return bits.empty();
+      }
+
+      /* blocks holds inclusive bit positions of N runs, in order */
+      void build(vector<mapObject> &blocks, uint64_t totalBases)
+      {
+          clear();
+          if (blocks.empty())
+              return;
+
+          uint64_t words = totalBases/64+2;
+          bits.assign(words, 0);
+          for (size_t b=0; b<blocks.size(); ++b)
+              for (uint64_t i=blocks[b].left/2; i<=blocks[b].right/2; ++i)
+                  bits[i>>6] |= (uint64_t)1 << (i&63);
+
+          nextN.assign(words+1, none);
+          for (uint64_t w=words; w-- > 0; )
+              nextN[w] = bits[w] ? (w<<6)+__builtin_ctzll(bits[w]) : nextN[w+1];
+
+          prevN.assign(words, none);
+          for (uint64_t w=0; w<words; ++w)
+              prevN[w] = bits[w] ? (w<<6)+63-__builtin_clzll(bits[w]) : (w ? prevN[w-1] : none);
+      }
+
+      /* Whether bases [from, from+len) hold an N, len <= 64 */
+      bool any(uint64_t from, uint64_t len)
+      {
+          uint64_t w=from>>6, o=from&63;
+          uint64_t x=bits[w]>>o;
+          if (o)
+              x |= bits[w+1]<<(64-o);
+          if (len < 64)
+              x &= ((uint64_t)1<<len)-1;
+          return x != 0;
+      }
+
+      /* First N at or after base i, or none */
+      uint64_t next(uint64_t i)
+      {
+          uint64_t w=i>>6;
+          if (w >= bits.size())
+              return none;
+          uint64_t x=bits[w] & (~(uint64_t)0<<(i&63));
+          return x ? (w<<6)+__builtin_ctzll(x) : nextN[w+1];
+      }
+
+      /* Last N at or before base i, or none */
+      uint64_t prev(uint64_t i)
+      {
+          uint64_t w=i>>6;
+          if (w >= bits.size())
+              return prevN.back();
+          uint64_t o=i&63;
+          uint64_t x=bits[w] & ((o==63)?~(uint64_t)0:(((uint64_t)1<<(o+1))-1));
+          return x ? (w<<6)+63-__builtin_clzll(x) : (w ? prevN[w-1] : none);
+      }
+};
+
 class seqFileReadInfo {
       fstream file;
       uint64_t size;
@@ -99,28 +181,83 @@ class seqFileReadInfo {
       uint64_t binReadsLocation;
       uint64_t currPos;
       uint64_t numSequences;
+      vector<AnnInterval> *mask;
+      size_t maskNext;
+      vector<char> buf;
+      uint64_t bufPos;
+      bool bufLoaded;
 
-      string& randomStr()
+      const char *randomStr()
       {
-         static string str("NNNNNNNNNN");
-         return str;
-      } 
-   
+         return "NNNNNNNNNN";
+      }
+
       void processTmpString(uint64_t &sz, uint64_t &blockNCount)
       {
           string line = strTmp;
           strTmp.clear();
           totalBases=0;
           binReadsLocation=0;
-          processInput(line, sz, blockNCount);
+          maskNext=0;
+          processInput(line.data(), line.size(), sz, blockNCount);
+      }
+
+      /*
+       * Whether the base at totalBases is masked; bases come in order,
+       * so the mask is followed with a cursor.
+       */
+      bool isMasked()
+      {
+          if (!mask)
+              return false;
+          while (maskNext < mask->size() && (*mask)[maskNext].end <= totalBases)
+              maskNext++;
+          return maskNext < mask->size() && (*mask)[maskNext].start <= totalBases;
+      }
+
+      /*
+       * Number of whole words from totalBases, which starts a word, that
+       * hold no masked base.
+       */
+      uint64_t unmaskedWords()
+      {
+          isMasked();
+          if (!mask || maskNext == mask->size())
+              return UINT64_MAX;
+          if ((*mask)[maskNext].start <= totalBases)
+              return 0;
+          return ((*mask)[maskNext].start-totalBases)/32;
+      }
+
+      /*
+       * Packs whole words of plain bases at once with encode_bases(), as
+       * long as they stay below size and clear of the mask; returns the
+       * number of characters of str consumed.
+       */
+      uint64_t encodeWords(const char *str, uint64_t n, uint64_t &blockNCount)
+      {
+          if (totalBases%32 || totalBases+32 > size)
+              return 0;
+
+          uint64_t words = min(min(n/32, (size-totalBases)/32), unmaskedWords());
+          uint64_t done = encode_bases((const unsigned char *)str, (unsigned int)min(words, (uint64_t)UINT32_MAX), &binReads[binReadsLocation]);
+
+          if (done && commonData::ignoreN && blockNCount){
+              blockOfNs.push_back(mapObject(CHARS2BITS(blockNCount-1), CHARS2BITS(totalBases-1)));
+              blockNCount=0;
+          }
+          totalBases+=32*done;
+          binReadsLocation+=done;
+          return 32*done;
       }
 
       /*
        * Function converts a character sequence into an array of integers.
-       * Input: character string
+       * Masked bases are treated like Ns.
+       * Input: n characters at str
        * Output: array of integers, total number of bases
        */
-      void processInput(string &str, uint64_t &sz, uint64_t &blockNCount)
+      void processInput(const char *str, uint64_t n, uint64_t &sz, uint64_t &blockNCount)
       {
           int chooseLetter=0;
           uint64_t k=0;
@@ -131,15 +268,18 @@ class seqFileReadInfo {
           }
 
           /* Processing the sequences by encoding the base pairs into 2 bits. */
-          for ( std::string::iterator it=str.begin(); it!=str.end(); ++it)
+          for (uint64_t i=0; i<n; ++i)
           {
               if (totalBases == sz){ //sz=size+minSize
-                  strTmp += *it;
-                  continue;
+                  strTmp.append(str+i, n-i);
+                  break;
               }else if (totalBases >= size) {
-                  strTmp += *it;
+                  strTmp += str[i];
+              }else if ((k = encodeWords(str+i, n-i, blockNCount))) {
+                  i += k-1;
+                  continue;
               }
-              switch(*it)
+              switch(isMasked()?'N':str[i])
               {
                   case 'A':
                   case 'a':
@@ -209,9 +349,14 @@ class seqFileReadInfo {
       uint64_t *binReads;
       uint64_t totalBases;
       std::vector <mapObject> blockOfNs;
+      nBitmap nBits;
       
       seqFileReadInfo() {
           size=0;
+          mask=NULL;
+          maskNext=0;
+          bufPos=0;
+          bufLoaded=false;
           currPos=0;
           binReadSize=0;
           binReadsLocation=0;
@@ -222,6 +367,10 @@ class seqFileReadInfo {
       seqFileReadInfo(string str)
       {
           size=0;
+          mask=NULL;
+          maskNext=0;
+          bufPos=0;
+          bufLoaded=false;
           currPos=0;
           binReadSize=0;
           binReadsLocation=0;
@@ -234,11 +383,21 @@ class seqFileReadInfo {
           }
       }
 
+      /*
+       * Masked intervals of the first sequence of the file, in base
+       * positions; they become blocks of Ns.
+       */
+      void setMask(vector<AnnInterval> *m) {
+          mask=m;
+          maskNext=0;
+      }
+
       uint64_t &getNumSequences() {
           return numSequences;
       }
 
       void openFile(string s){
+          bufLoaded=false;
           file.open(s, ios::in);
           if(!file.is_open()) {
               cout << "ERROR: unable to open "<< s << " file" << endl;
@@ -265,6 +424,8 @@ class seqFileReadInfo {
           strName.clear();
           strTmp.clear();
           clearMapForNs();
+          vector<char>().swap(buf);
+          bufLoaded=false;
           delete [] binReads;
       }
 
@@ -272,7 +433,40 @@ class seqFileReadInfo {
       {
           file.clear();
           file.seekg(0, ios::beg);
+          bufPos=0;
       } 
+
+      /* Reads the whole file into buf, which readChunks() walks */
+      void loadBuffer()
+      {
+          file.clear();
+          file.seekg(0, ios::end);
+          uint64_t n=file.tellg();
+          file.seekg(0, ios::beg);
+          buf.resize(n);
+          file.read(buf.data(), n);
+          file.clear();
+          bufLoaded=true;
+      }
+
+      /*
+       * Next line of buf without its newline; like getline(), a last
+       * line that has no newline is not returned.
+       */
+      bool nextLine(const char *&line, uint64_t &len)
+      {
+          if (bufPos >= buf.size())
+              return false;
+          line=buf.data()+bufPos;
+          const char *end=(const char *)memchr(line, '\n', buf.size()-bufPos);
+          if (!end) {
+              bufPos=buf.size();
+              return false;
+          }
+          len=end-line;
+          bufPos+=len+1;
+          return true;
+      }
     
       uint64_t allocBinArray()
       {
@@ -285,6 +479,7 @@ class seqFileReadInfo {
       void clearMapForNs()
       {
           blockOfNs.clear();
+          nBits.clear();
       } 
 
       void clearTmpString()
@@ -296,83 +491,49 @@ class seqFileReadInfo {
       
       void getKmerLeftnRightBoundForNs(uint64_t &currKmerPos, mapObject &bounds)
       {
-          uint64_t right=0;
           /*
            * Since we do all computation with bits, all our
            * positions are even. Here I return 1 (odd position),
            * an indication of no Ns towards left   
            */
 
-          if (!blockOfNs.size()){
+          if (nBits.empty()){
               bounds.left=0x1;
               bounds.right=CHARS2BITS(totalBases-1);
               return;
           }
 
-          vector<mapObject>::iterator it;
-          it=upper_bound(blockOfNs.begin(), blockOfNs.end(), currKmerPos, mapObject()); 
-          /* No N block beyond this point */
-          if (it == blockOfNs.end())
-              right = CHARS2BITS(totalBases-1);
-          else
-              right = (*it).left-2;
-
           /* This function never gets a position which is N */
-          if (!currKmerPos || it==blockOfNs.begin()){
-              bounds.left=0x1;
-              bounds.right=right;
-              return;
-          }
+          uint64_t base=currKmerPos/2;
+          uint64_t next=nBits.next(base);
+          uint64_t prev=base?nBits.prev(base-1):nBitmap::none;
 
-          --it;
-
-          bounds.left=(*it).right+2;
-          bounds.right=right;
-          return;
+          bounds.right=(next==nBitmap::none)?CHARS2BITS(totalBases-1):CHARS2BITS(next)-2;
+          bounds.left=(!currKmerPos || prev==nBitmap::none)?0x1:CHARS2BITS(prev)+2;
       }
 
-      bool checkKmerForNs(uint64_t &currKmerPos, vector<mapObject>::iterator &it)
+      /* Whether the kmer at bit position currKmerPos holds an N */
+      bool checkKmerForNs(uint64_t currKmerPos)
       {
-          if (!blockOfNs.size())
+          if (nBits.empty())
               return false;
 
-          while(it != blockOfNs.end())
-          {
-              if ((*it).left>currKmerPos)
-                  break;
-              else
-                  ++it;
-          }    
-    
+          return nBits.any(currKmerPos/2, commonData::kmerSize/2);
+      }
 
-          /* No N block beyond this point */
-          if (it == blockOfNs.end()){
-              --it;
-              /* Current position within N block */
-              if (((*it).left <=currKmerPos) && (currKmerPos <= (*it).right)){
-                  ++it;
-                  return true;
-              }else{
-                  ++it;
-                  return false;
-              }
-          }
- 
-          if ((*it).left > (currKmerPos+commonData::kmerSize-2)){
-              if (it != blockOfNs.begin()){
-                  --it;
-                  if ((*it).right < currKmerPos){
-                      ++it;
-                      return false;
-                  }else {
-                      ++it;
-                      return true;
-                  }
-              }else
-                  return false;
-          }else {
-              return true;
-          }
+      /*
+       * First bit position after the last N of the kmer at currKmerPos;
+       * every kmer starting before it holds that N.
+       */
+      uint64_t skipKmerNs(uint64_t currKmerPos)
+      {
+          return CHARS2BITS(nBits.prev(currKmerPos/2+commonData::kmerSize/2-1)+1);
+      }
+
+      /* Builds nBits from blockOfNs once a chunk is read */
+      void buildMapForNs()
+      {
+          nBits.build(blockOfNs, totalBases);
       }
 
 
@@ -390,20 +551,23 @@ class seqFileReadInfo {
 
       bool readChunks()
       {
-          string line;
+          const char *line;
+          uint64_t len;
           uint64_t blockNCount=0;
           int minSize = commonData::minMemLen/2-1;
           uint64_t sz=size+minSize;
+          if (!bufLoaded)
+              loadBuffer();
           /* Process anything remaining from the last iteration */
           processTmpString(sz, blockNCount);
           
-          while(getline( file, line ).good() ){
-              if(line[0] == '>' || (totalBases == sz)){
+          while(nextLine(line, len)){
+              if((len && line[0] == '>') || (totalBases == sz)){
                   if( !strName.empty()){ // Process what we read from the last entry
-                     if(line[0] != '>') {
-                          processInput(line, sz, blockNCount);
+                     if(!len || line[0] != '>') {
+                          processInput(line, len, sz, blockNCount);
                       }else {
-                          processInput(randomStr(), sz, blockNCount);
+                          processInput(randomStr(), RANDOM_SEQ_SIZE, sz, blockNCount);
                       }
                       if (totalBases == sz) {
                           if ((totalBases%32)!=0)
@@ -417,14 +581,15 @@ class seqFileReadInfo {
                               blockOfNs.push_back(mapObject(CHARS2BITS(blockNCount-1), CHARS2BITS(totalBases-1)));
                               blockNCount=0;
                           }
+                          buildMapForNs();
                           return true;
                       }
                   }
-                  if( !line.empty() ){
-                      strName = line.substr(1);
+                  if( len ){
+                      strName.assign(line+1, len-1);
                   }
               } else if( !strName.empty() ){
-                  processInput(line, sz, blockNCount);
+                  processInput(line, len, sz, blockNCount);
               }
           }
 
@@ -442,6 +607,7 @@ class seqFileReadInfo {
               }
               if (!strTmp.size())
                   strName.clear();
+              buildMapForNs();
               return true;
           }
           return false;
@@ -680,6 +846,16 @@ class tmpFilesInfo {
       return (obj1.lR>=obj2.lR?false:true);
     }
 
+    static uint64_t memext_lQ(const MemExt &obj)
+    {
+      return obj.lQ;
+    }
+
+    static uint64_t memext_lR(const MemExt &obj)
+    {
+      return obj.lR;
+    }
+
     static bool myUnique(const MemExt &obj1, const MemExt &obj2)
     {
       if((obj1.lQ==obj2.lQ) && (obj1.rQ==obj2.rQ) && (obj1.rR==obj2.rR) && (obj1.lR==obj2.lR))
@@ -691,15 +867,12 @@ class tmpFilesInfo {
     void openFiles(ios_base::openmode mode, int numFiles) {
         char buffer[256];
         memset(buffer,0,256);
-        static int flag=0;
         sprintf(buffer, "%s", commonData::nucmer_path);
-        if (!flag) {
-            if(mkdir(buffer, S_IRWXU|S_IRGRP|S_IXGRP))
-            {
-                cout << "ERROR: unable to open temporary directory" << endl;
-                exit( EXIT_FAILURE );
-            }
-            flag=1;
+        /* Made on every search: the last one of the process removed it */
+        if(mkdir(buffer, S_IRWXU|S_IRGRP|S_IXGRP) && errno != EEXIST)
+        {
+            cout << "ERROR: unable to open temporary directory" << endl;
+            exit( EXIT_FAILURE );
         }
         /* Last two files hold the sequence/pos mapping
          * for reference and query file respectively
@@ -767,7 +940,7 @@ class tmpFilesInfo {
         uint64_t &rQue = m.rQ;
         static int flag=0;
         vector<seqData>::iterator itR;
-        static vector<seqData>::iterator itQ=querySeqInfo.begin();
+        vector<seqData>::iterator itQ=querySeqInfo.begin();
         seqData s;
         
         /* print remianing query sequences - if any */
@@ -1059,7 +1232,9 @@ void removeDuplicates(vector<seqData> &refSeqInfo, vector<seqData> &querySeqInfo
             while(!TmpFiles[i].read((char *)&m, sizeof (MemExt)).eof()) {
                 MemExtVec.push_back(m);
             }
-            sort(MemExtVec.begin(), MemExtVec.end(), MemExt());
+            /* Same order as MemExt(): by lQ, then by lR */
+            radix_sort(MemExtVec, memext_lR);
+            radix_sort(MemExtVec, memext_lQ);
             if (commonData::d==1 &&  commonData::numThreads==1)   // Everything is unique
                 last=MemExtVec.end();
             else
@@ -0,0 +1,132 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include "cnef.h"
+
+using namespace std;
+
+/*
+Masks are sorted lists of disjoint, non-adjacent half-open intervals [start,
+end) of positions in a region
+*/
+static bool order_mask( const AnnInterval & a, const AnnInterval & b )
+{
+	return a.start < b.start;
+}
+
+/*
+Sorts mask and joins the intervals that overlap or touch
+*/
+void mask_normalise( vector<AnnInterval> * mask )
+{
+	if( mask->empty() )
+		return;
+
+	sort( mask->begin(), mask->end(), order_mask );
+
+	unsigned int k = 0;
+	for( unsigned int i = 1; i < mask->size(); i++ )
+	{
+		if( ( *mask )[i].start <= ( *mask )[k].end )
+			( *mask )[k].end = max( ( *mask )[k].end, ( *mask )[i].end );
+		else
+			( *mask )[++k] = ( *mask )[i];
+	}
+	mask->resize( k + 1 );
+}
+
+/*
+Adds the runs of the mask symbol in s[0..len), the N and soft-masked bases
+turned into '$' when the genome is read
+*/
+void mask_add_runs( unsigned char * s, unsigned int len, vector<AnnInterval> * mask )
+{
+	unsigned char * p = s;
+	unsigned char * end = s + len;
+
+	while( ( p = ( unsigned char * ) memchr( p, DOL, end - p ) ) != NULL )
+	{
+		AnnInterval run;
+
+		run.start = p - s;
+		while( p < end && *p == DOL )
+			p++;
+		run.end = p - s;
+		mask->push_back( run );
+	}
+}
+
+/*
+Adds the exons, in genome positions, that fall in the region [offset, offset +
+len), clipped to it and moved to region positions
+*/
+void mask_add_exons( vector<AnnInterval> * exons, unsigned int offset, unsigned int len, vector<AnnInterval> * mask )
+{
+	for( unsigned int i = 0; i < exons->size(); i++ )
+	{
+		unsigned int start = max( ( *exons )[i].start, offset );
+		unsigned int end = min( ( *exons )[i].end, offset + len );
+
+		if( end <= start )
+			continue;
+
+		AnnInterval e = { start - offset, end - offset };
+		mask->push_back( e );
+	}
+}
+
+/*
+Moves a mask of a region of length len to the reverse complement of the region
+*/
+void mask_reverse( vector<AnnInterval> * mask, unsigned int len )
+{
+	reverse( mask->begin(), mask->end() );
+
+	for( unsigned int i = 0; i < mask->size(); i++ )
+		rc_interval( len, &( *mask )[i] . start, &( *mask )[i] . end );
+}
+
+/*
+Whether [from, to) contains a masked position
+*/
+bool mask_overlaps( vector<AnnInterval> * mask, unsigned int from, unsigned int to )
+{
+	if( to <= from )
+		return false;
+
+	AnnInterval key = { to, 0 };
+	vector<AnnInterval>::iterator it = lower_bound( mask->begin(), mask->end(), key, order_mask );
+
+	/* The last interval starting before to is the only one that can reach from */
+	return it != mask->begin() && ( it - 1 )->end > from;
+}
+
+/*
+Writes the mask symbol over the masked positions of s, for the aligners, which
+see masked positions as '$'
+*/
+void mask_apply( unsigned char * s, vector<AnnInterval> * mask )
+{
+	for( unsigned int i = 0; i < mask->size(); i++ )
+		memset( &s[( *mask )[i].start], DOL, ( *mask )[i].end - ( *mask )[i].start );
+}
@@ -0,0 +1,274 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
+#include "cnef.h"
+
+using namespace std;
+
+#define OUT_BUFFER		( 1 << 20 )
+#define OUT_ROW			256
+
+static const char out_magic[8] = { 'C', 'N', 'E', 'F', 'B', 'I', 'N', '\0' };
+
+/*
+Row formatting: std::to_chars where the library has it, otherwise the same
+digits by hand and through snprintf()
+*/
+static inline char * out_uint( char * p, unsigned int v )
+{
+#if defined( __cpp_lib_to_chars )
+	return to_chars( p, p + 10, v ).ptr;
+#else
+	char d[10];
+	int n = 0;
+
+	do
+	{
+		d[n++] = '0' + v % 10;
+		v /= 10;
+	} while( v );
+
+	while( n )
+		*p++ = d[--n];
+
+return p;
+#endif
+}
+
+static inline char * out_similarity( char * p, double v )
+{
+#if defined( __cpp_lib_to_chars )
+	return to_chars( p, p + OUT_ROW / 2, v, chars_format::fixed, 2 ).ptr;
+#else
+	return p + snprintf( p, OUT_ROW / 2, "%.2f", v );
+#endif
+}
+
+static inline char * out_string( char * p, const string & s )
+{
+	memcpy( p, s.data(), s.size() );
+
+return p + s.size();
+}
+
+/*
+Whether a CNE is long enough to be reported
+*/
+static inline bool out_reported( MimOcc * m, TSwitch sw )
+{
+	return m->endQuery - m->startQuery >= sw . l || m->endRef - m->startRef >= sw . l;
+}
+
+/*
+The nine tab-separated columns of flank's Parse_cnef_output() for one CNE whose
+coordinates are already in genome positions
+*/
+static char * out_row( char * p, MimOcc * m, const string & chrRef, const string & chrQuery )
+{
+	unsigned int lenRef = m->endRef - m->startRef;
+	unsigned int lenQuery = m->endQuery - m->startQuery;
+	unsigned int minLen = min( lenQuery, lenRef );
+	double threshold = ( 1.0 - ( m->error * 1.0 / minLen * 1.0 ) ) * 100.0;
+
+	p = out_string( p, chrRef );
+	*p++ = '\t';
+	p = out_uint( p, m->startRef );
+	*p++ = '\t';
+	p = out_uint( p, m->endRef );
+	*p++ = '\t';
+	p = out_string( p, chrQuery );
+	*p++ = '\t';
+	p = out_uint( p, m->startQuery );
+	*p++ = '\t';
+	p = out_uint( p, m->endQuery );
+	*p++ = '\t';
+	p = out_uint( p, lenRef );
+	*p++ = '\t';
+	p = out_uint( p, lenQuery );
+	*p++ = '\t';
+	p = out_similarity( p, threshold );
+	*p++ = '\n';
+
+return p;
+}
+
+/*
+CNEs that pass -l, moved by the start positions of the two extracted regions
+*/
+static void out_place( vector<MimOcc> * mims, TSwitch sw, unsigned int startRef, unsigned int startQuery, vector<MimOcc> * placed )
+{
+	placed->reserve( mims->size() );
+
+	for( unsigned int i = 0; i < mims->size(); i++ )
+	{
+		MimOcc m = ( *mims )[i];
+
+		if( ! out_reported( &m, sw ) )
+			continue;
+
+		m.startRef += startRef;
+		m.endRef += startRef;
+		m.startQuery += startQuery;
+		m.endQuery += startQuery;
+		placed->push_back( m );
+	}
+}
+
+/*
+Writes the rows of cnes into a large buffer that is flushed with fwrite()
+*/
+int write_cnes_text( FILE * out, vector<MimOcc> * cnes, const string & chrRef, const string & chrQuery )
+{
+	size_t fixed = OUT_ROW + chrRef.size() + chrQuery.size();
+	vector<char> buf( OUT_BUFFER + fixed );
+	char * p = buf.data();
+
+	for( unsigned int i = 0; i < cnes->size(); i++ )
+	{
+		p = out_row( p, &( *cnes )[i], chrRef, chrQuery );
+
+		if( p - buf.data() >= OUT_BUFFER )
+		{
+			if( fwrite( buf.data(), 1, p - buf.data(), out ) != ( size_t ) ( p - buf.data() ) )
+				return ( 1 );
+			p = buf.data();
+		}
+	}
+
+	if( fwrite( buf.data(), 1, p - buf.data(), out ) != ( size_t ) ( p - buf.data() ) )
+		return ( 1 );
+
+return 0;
+}
+
+static int out_put( FILE * out, const void * v, size_t n )
+{
+	return fwrite( v, 1, n, out ) != n;
+}
+
+/*
+Binary output: the header, then one fixed-width record per CNE.
+
+	char[8]		"CNEFBIN\0"
+	uint32		format version (CNE_BIN_VERSION)
+	uint32		record size in bytes (sizeof( MimOcc ), 20)
+	uint64		number of records
+	uint32, char[]	reference chromosome: length, then the name
+	uint32, char[]	query chromosome: length, then the name
+	MimOcc[]	startRef, endRef, startQuery, endQuery, error
+
+All integers are in the byte order of the machine that wrote the file and the
+coordinates are genome positions, as in the text output.
+*/
+int write_cnes_bin( FILE * out, vector<MimOcc> * cnes, const string & chrRef, const string & chrQuery )
+{
+	uint32_t version = CNE_BIN_VERSION;
+	uint32_t size = sizeof( MimOcc );
+	uint64_t count = cnes->size();
+	uint32_t lenRef = chrRef.size();
+	uint32_t lenQuery = chrQuery.size();
+
+	if( out_put( out, out_magic, sizeof( out_magic ) ) || out_put( out, &version, sizeof( version ) ) || out_put( out, &size, sizeof( size ) ) || out_put( out, &count, sizeof( count ) ) )
+		return ( 1 );
+	if( out_put( out, &lenRef, sizeof( lenRef ) ) || out_put( out, chrRef.data(), lenRef ) || out_put( out, &lenQuery, sizeof( lenQuery ) ) || out_put( out, chrQuery.data(), lenQuery ) )
+		return ( 1 );
+	if( count && out_put( out, cnes->data(), count * sizeof( MimOcc ) ) )
+		return ( 1 );
+
+return 0;
+}
+
+/*
+Writes the CNEs that pass -l in the format chosen with --out-format
+*/
+int write_cnes( FILE * out, vector<MimOcc> * mims, TSwitch sw, const string & chrRef, unsigned int startRef, const string & chrQuery, unsigned int startQuery )
+{
+	vector<MimOcc> placed;
+
+	out_place( mims, sw, startRef, startQuery, &placed );
+
+	if( sw . O == OUT_BIN )
+		return write_cnes_bin( out, &placed, chrRef, chrQuery );
+
+return write_cnes_text( out, &placed, chrRef, chrQuery );
+}
+
+static int in_get( FILE * in, void * v, size_t n )
+{
+	return fread( v, 1, n, in ) != n;
+}
+
+static int in_string( FILE * in, string * s )
+{
+	uint32_t len;
+
+	if( in_get( in, &len, sizeof( len ) ) || len > OUT_BUFFER )
+		return ( 1 );
+
+	s->resize( len );
+	if( len && in_get( in, &( *s )[0], len ) )
+		return ( 1 );
+
+return 0;
+}
+
+/*
+Loads a file written with --out-format bin
+*/
+int read_cnes_bin( FILE * in, CneFile * f )
+{
+	char magic[8];
+	uint32_t version, size;
+	uint64_t count;
+
+	if( in_get( in, magic, sizeof( magic ) ) || memcmp( magic, out_magic, sizeof( magic ) ) )
+	{
+		fprintf( stderr, " Error: not a CNEFinder binary file!\n" );
+		return ( 1 );
+	}
+
+	if( in_get( in, &version, sizeof( version ) ) || in_get( in, &size, sizeof( size ) ) || version != CNE_BIN_VERSION || size != sizeof( MimOcc ) )
+	{
+		fprintf( stderr, " Error: unsupported CNEFinder binary format!\n" );
+		return ( 1 );
+	}
+
+	if( in_get( in, &count, sizeof( count ) ) || in_string( in, &f->chrRef ) || in_string( in, &f->chrQuery ) )
+	{
+		fprintf( stderr, " Error: truncated CNEFinder binary file!\n" );
+		return ( 1 );
+	}
+
+	f->cnes.resize( count );
+	if( count && in_get( in, f->cnes.data(), count * sizeof( MimOcc ) ) )
+	{
+		fprintf( stderr, " Error: truncated CNEFinder binary file!\n" );
+		return ( 1 );
+	}
+
+return 0;
+}
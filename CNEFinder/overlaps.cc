@@ -24,111 +24,116 @@
 #include <string.h>
 #include <sys/time.h>
 #include <algorithm>
+#include <map>
 #include <omp.h>
 #include "cnef.h"
 
 using namespace std;
 
+/*
+Whether CNE a overlaps CNE b in both the reference and the query
+*/
+static inline bool cne_overlap( MimOcc * a, MimOcc * b )
+{
+	return a->startRef < b->endRef && b->startRef < a->endRef && a->startQuery < b->endQuery && b->startQuery < a->endQuery;
+}
 
-int remove_overlaps( vector<MimOcc> * mims, TSwitch sw )
+/*
+Order in which the CNEs of a run claim their positions: longest first, then the
+fewest errors, then by position so that the choice is deterministic
+*/
+static bool order_claim( MimOcc * a, MimOcc * b )
 {
-	vector<MimOcc> * temp = new vector<MimOcc>;
+	unsigned int lenA = ( a->endRef - a->startRef ) + ( a->endQuery - a->startQuery );
+	unsigned int lenB = ( b->endRef - b->startRef ) + ( b->endQuery - b->startQuery );
 
-	temp->push_back(mims->at(0));
-	int i = 1;
-	while( i < mims->size()  )
-	{
+	if( lenA != lenB )
+		return lenA > lenB;
+	if( a->error != b->error )
+		return a->error < b->error;
+	if( a->startRef != b->startRef )
+		return a->startRef < b->startRef;
 
-		
-		int mimEndQuery = mims->at(i).endQuery;
-		int mimStartQuery = mims->at(i).startQuery;
-		int mimEndRef = mims->at(i).endRef;
-		int mimStartRef = mims->at(i).startRef;
-		
-		int tempEndQuery =  temp->at( temp->size() -1 ).endQuery;
-		int tempStartQuery = temp->at( temp->size() -1).startQuery;
-		int tempEndRef =  temp->at( temp->size() -1 ).endRef;
-		int tempStartRef =  temp->at( temp->size() -1).startRef;
-
-		if(  mimEndQuery - mimStartQuery < sw . l && mimEndRef - mimStartRef < sw . l )
-		{
-			i++;
-		}
-		else if(  mimStartRef >=  tempStartRef &&  mimEndRef <=  tempEndRef &&  mimStartQuery >= tempStartQuery &&  mimEndQuery <=  tempEndQuery )
-		{ 
-			i++;
-		}
-		else if( tempStartRef >= mimStartRef && tempEndRef <=  mimEndRef &&  tempStartQuery >=  mimStartQuery &&  tempEndQuery <= mimEndQuery )	
-		{
-			temp->erase( temp->begin() + temp->size() -1 );
-			temp->push_back( mims->at(i) );
-			i++;
-		}	
-		else if( tempStartRef <= mimStartRef && tempEndRef >=  mimEndRef &&  mimStartQuery >= tempStartQuery && mimStartQuery < tempEndQuery && mimEndQuery >= tempEndQuery  || tempStartRef <= mimStartRef && tempEndRef >=  mimEndRef  && mimStartQuery <= tempStartQuery && tempStartQuery < mimEndQuery && mimEndQuery <= tempEndQuery )
-		{
-			i++;
+	return a->startQuery < b->startQuery;
+}
 
-		}
-		else if ( tempStartQuery <=  mimStartQuery &&  tempEndQuery >= mimEndQuery &&  mimStartRef >= tempStartRef && mimStartRef < tempEndRef && mimEndRef >= tempEndRef  || tempStartQuery <=  mimStartQuery &&  tempEndQuery >= mimEndQuery && mimStartRef >= tempStartRef && mimStartRef < tempEndRef && mimEndRef >= tempEndRef )
-		{
-			i++;
-		}
-		else if( mimStartRef >= tempStartRef && mimStartRef < tempEndRef && mimEndRef >= tempEndRef && mimStartQuery >= tempStartQuery && mimStartQuery < tempEndQuery && mimEndQuery >= tempEndQuery || mimStartRef >= tempStartRef && mimStartRef < tempEndRef && mimEndRef >= tempEndRef && mimStartQuery <= tempStartQuery && tempStartQuery < mimEndQuery && mimEndQuery <= tempEndQuery  )	
-		{	
-			int lenMimRef = mimEndRef - mimStartRef;
-			int lenTempRef = tempEndRef - tempStartRef;
+/*
+Resolves the CNEs mims[from..to), whose reference intervals form one connected
+run, and sets keep for the ones that remain. Each CNE in order_claim() order is
+kept unless it overlaps one kept before it; kept CNEs are indexed by startRef, so
+only those starting less than the longest kept reference length before it are
+compared.
+*/
+static void resolve_run( vector<MimOcc> * mims, int from, int to, vector<char> * keep )
+{
+	vector<MimOcc*> claim;
+	for( int i = from; i < to; i++ )
+		claim.push_back( &( *mims )[i] );
+	sort( claim.begin(), claim.end(), order_claim );
 
-			int lenMimQuery = mimEndQuery - mimStartQuery;
-			int lenTempQuery = tempEndQuery  - mimStartQuery;
+	multimap<unsigned int, MimOcc*> kept;
+	unsigned int maxLen = 0;
 
-				
-			if( lenMimRef > lenTempRef && lenMimQuery > lenTempRef )
-			{
-				temp->erase( temp->begin() + temp->size() -1 );
-				temp->push_back( mims->at(i) );
-				i++;
-			}
-			else if( lenMimRef >= lenTempRef && lenMimQuery <= lenTempQuery )
-			{
-				if(  lenMimRef - lenTempRef > lenTempQuery - lenMimQuery )
-				{	
-					temp->erase( temp->begin() + temp->size() -1 );
-					temp->push_back( mims->at(i) );
-						
-				}
-				i++;
-			}
-			else if( lenMimRef <= lenTempRef && lenMimQuery <= lenTempRef )
-			{
-				i++;
-			}
-			else if( lenMimRef <= lenTempRef && lenMimQuery >= lenTempQuery )
-			{
-				if(  lenTempRef-lenMimRef < lenMimQuery - lenTempQuery )
-				{	
-					temp->erase( temp->begin() + temp->size() -1 );
-					temp->push_back( mims->at(i) );
-						
-				}
-				i++;
-			}
-			else i++;
+	for( unsigned int k = 0; k < claim.size(); k++ )
+	{
+		MimOcc * m = claim[k];
+		unsigned int lo = ( m->startRef > maxLen ) ? m->startRef - maxLen : 0;
+		bool overlap = false;
 
-		}
-		else
+		for( multimap<unsigned int, MimOcc*>::iterator it = kept.lower_bound( lo ); it != kept.end() && it->first < m->endRef; it++ )
 		{
-			temp->push_back( mims->at(i) );
-			i++;
+			if( cne_overlap( m, it->second ) )
+			{
+				overlap = true;
+				break;
+			}
 		}
+
+		if( overlap )
+			continue;
+
+		kept.insert( make_pair( m->startRef, m ) );
+		maxLen = max( maxLen, m->endRef - m->startRef );
+		( *keep )[m - &( *mims )[0]] = 1;
+	}
+}
+
+/*
+Removes CNEs shorter than sw.l in both sequences and resolves overlaps between
+all the others, not only between neighbours. mims is sorted by startRef; it is
+cut into runs of CNEs whose reference intervals are connected, which cannot
+overlap each other across runs and are resolved in parallel. The CNEs that
+remain are compacted in place, in their original order.
+*/
+int remove_overlaps( vector<MimOcc> * mims, TSwitch sw )
+{
+	int n = 0;
+	for( unsigned int i = 0; i < mims->size(); i++ )
+		if( ( *mims )[i].endQuery - ( *mims )[i].startQuery >= sw . l || ( *mims )[i].endRef - ( *mims )[i].startRef >= sw . l )
+			( *mims )[n++] = ( *mims )[i];
+	mims->resize( n );
+
+	vector<int> runs;
+	unsigned int reach = 0;
+	for( int i = 0; i < n; i++ )
+	{
+		if( i == 0 || ( *mims )[i].startRef >= reach )
+			runs.push_back( i );
+		reach = max( reach, ( *mims )[i].endRef );
 	}
+	runs.push_back( n );
 
-	mims->clear();
+	vector<char> keep( n, 0 );
 
-	for(int i=0; i<temp->size(); i++)
-		mims->push_back(temp->at(i));
+	#pragma omp parallel for schedule( dynamic, 1 )
+	for( int r = 0; r < ( int ) runs.size() - 1; r++ )
+		resolve_run( mims, runs[r], runs[r+1], &keep );
 
-	delete( temp );
+	int kept = 0;
+	for( int i = 0; i < n; i++ )
+		if( keep[i] )
+			( *mims )[kept++] = ( *mims )[i];
+	mims->resize( kept );
 
 return 0;
 }
-
@@ -0,0 +1,97 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include "cnef.h"
+
+using namespace std;
+
+/*
+The search of one cnef call once its regions are extracted: the CNEs between
+ref and query, of lengths ref_len and query_len and with masks built from their
+runs and exons, go to mims in region positions. Both regions are changed in
+place. Returns 1 when E-MEM finds no matches
+*/
+int find_cnes( TSwitch sw, unsigned char * ref, unsigned int ref_len, unsigned char * query, unsigned int query_len, SeqMasks * masks, unsigned int q_gram_size, vector<MimOcc> * mims )
+{
+	/* With -v the query region is replaced by its reverse complement up to the output */
+	stats_stage( STAGE_MASK );
+	if( sw . v == 1 )
+	{
+		rev_complement( query, query, query_len );
+		mask_reverse( &masks->query, query_len );
+	}
+
+	/* The input of E-MEM */
+	stats_stage( STAGE_INDEX );
+	double written = trace_now();
+	ofstream new_ref;
+	new_ref.open(string(sw.output_filename)+"_new_ref.fa");
+  	new_ref <<">"<<"new_ref_"+string(sw.output_filename)<<"\n"<<ref<<"\n";
+  	new_ref.close();  
+
+	ofstream new_query;
+	new_query.open(string(sw.output_filename)+"_new_query.fa");
+  	new_query <<">"<<"new_query_"+string(sw.output_filename)<<"\n"<<query<<"\n";
+  	new_query.close();  
+	trace_span( "write E-MEM input", written, trace_now(), ref_len + query_len );
+
+	/* E-MEM takes the masks as intervals; the aligners see masked positions as '$' */
+	stats_stage( STAGE_MASK );
+	mask_apply( ref, &masks->ref );
+	mask_apply( query, &masks->query );
+
+	vector<QGramOcc> * q_grams = new vector<QGramOcc>;
+
+	find_maximal_exact_matches( q_gram_size , ref, query , q_grams,  sw, masks );
+
+	if( q_grams->size() == 0 && sw . l == 4  )
+	{
+		fprintf( stderr, " Error: No CNEs found.\n" );
+		delete( q_grams );
+		return ( 1 );
+	}
+	else if( q_grams->size() == 0  )
+	{
+		fprintf( stderr, " Error: No Matches found, try using a smaller value for minimum length.\n" );
+		delete( q_grams );
+		return ( 1 );
+	}
+
+	find_maximal_inexact_matches( sw , ref, query, q_grams, mims, q_gram_size, masks );
+
+	stats_stage( STAGE_OVERLAPS );
+	if( sw . x == 1 )
+	{
+		remove_overlaps( mims, sw );
+
+	}
+	stats_count( STAT_CNES, mims->size() );
+
+	stats_stage( STAGE_OUTPUT );
+	if( sw . v == 1 )
+		rc_cnes( mims, query_len );
+
+	delete( q_grams );
+
+return 0;
+}
@@ -39,8 +39,10 @@
 #include "boost/algorithm/string.hpp"
 #include "boost/tokenizer.hpp"
 #include <sys/stat.h>
+#include <errno.h>
 #include "qgrams.h"
 #include "cnef.h"
+#include "radix.h"
 #include "file.h"
 #include "qlist.h"
 
@@ -58,15 +60,15 @@ void buildRefHash(Knode* &refHash, uint64_t totalBits, seqFileReadInfo &RefFile)
     uint64_t currKmerPos=0, currKmer=0;
     int32_t offset=0; 
     int nextKmerPosition = commonData::minMemLen - commonData::kmerSize + 2;
-    vector<mapObject>::iterator it;
-    it = upper_bound(RefFile.blockOfNs.begin(), RefFile.blockOfNs.end(), currKmerPos, mapObject()); 
     while (currKmerPos<=totalBits)
     {
         if (currKmerPos + commonData::kmerSize - 2 > totalBits)
             break;
 
-        if(RefFile.checkKmerForNs(currKmerPos, it)){
-            currKmerPos+=nextKmerPosition; // Move L-K+2 bits = 50-28+1=23 char = 46 bits
+        if(RefFile.checkKmerForNs(currKmerPos)){
+            /* Jump past the last N of the kmer, keeping to the sampled positions */
+            uint64_t next = RefFile.skipKmerNs(currKmerPos);
+            currKmerPos += ((next-currKmerPos+nextKmerPosition-1)/nextKmerPosition)*nextKmerPosition;
             continue;
         }
 
@@ -292,8 +294,8 @@ void reportMEM(Knode * &refHash, uint64_t totalBases, uint64_t totalQBases, seqF
       uint32_t first=1;
       int kmerWithNs=0;
       mapObject QueryNpos, RefNpos;
-      vector<mapObject>::iterator it;
-      it = upper_bound(QueryFile.blockOfNs.begin(), QueryFile.blockOfNs.end(), 0, mapObject()); 
+      uint64_t skipTo=0;
+      uint64_t kmerHits=0;
 
       #pragma omp single
       {
@@ -315,14 +317,24 @@ void reportMEM(Knode * &refHash, uint64_t totalBases, uint64_t totalQBases, seqF
       }   
       
 
-      #pragma omp for 
+      /* No barrier after the loop, so that the span of each thread ends with its work */
+      double traced = trace_now();
+
+      #pragma omp for schedule(static) nowait
       for (uint64_t currKmerPos=0; currKmerPos<=totalQBits; currKmerPos+=2)
       {
           if ((currKmerPos + commonData::kmerSize - 2) > totalQBits)
               continue;
         
-          if(QueryFile.checkKmerForNs(currKmerPos, it)){
+          /* 
+           * Each thread walks its positions in order, so the kmers up
+           * to skipTo all hold the N found last 
+           */
+          if (currKmerPos < skipTo){
+              kmerWithNs=1;
+          }else if(QueryFile.checkKmerForNs(currKmerPos)){
               kmerWithNs=1;
+              skipTo=QueryFile.skipKmerNs(currKmerPos);
           }
 
           j=currKmerPos/DATATYPE_WIDTH;// current location in binReads 
@@ -349,6 +361,7 @@ void reportMEM(Knode * &refHash, uint64_t totalBases, uint64_t totalQBases, seqF
           if (refHash->findKmer(currKmer & global_mask_left[commonData::kmerSize/2 - 1], dataPtr)) 
           {
               // We have a match
+              kmerHits+=dataPtr[0];
               for (uint64_t n=1; n<=dataPtr[0]; n++) {   
                   // Check if MEM has already been discovered, if not proces it
                   if (!(currQueryMEMs->checkRedundantMEM(&currQueryMEMs, dataPtr[n], currKmerPos, CHARS2BITS(totalBases), currMEMs)))
@@ -358,6 +371,8 @@ void reportMEM(Knode * &refHash, uint64_t totalBases, uint64_t totalQBases, seqF
       }
       currMEMs.clear();
       currQueryMEMs->ListFree(&currQueryMEMs);
+      stats_count( STAT_KMER_HITS, kmerHits );
+      trace_span( "seed chunk", traced, trace_now(), kmerHits );
   }  
 }
 
@@ -366,7 +381,10 @@ void processQuery(Knode * &refHash, seqFileReadInfo &RefFile, seqFileReadInfo &Q
     QueryFile.clearFileFlag();
     QueryFile.resetCurrPos();
     for (int32_t i=0; i<commonData::d; i++) {
-        if(QueryFile.readChunks()){
+        double read = trace_now();
+        bool chunk = QueryFile.readChunks();
+        trace_span( "read query chunk", read, trace_now(), QueryFile.totalBases );
+        if(chunk){
             reportMEM(refHash, RefFile.totalBases-1, QueryFile.totalBases-1, RefFile, QueryFile, arrayTmpFile, revComplement, sw);
             QueryFile.setCurrPos();
             QueryFile.clearMapForNs();
@@ -406,6 +424,7 @@ void processReference(seqFileReadInfo &RefFile, seqFileReadInfo &QueryFile, tmpF
 
     buildRefHash(refHash, CHARS2BITS(RefFile.totalBases-1), RefFile);
 
+    stats_stage( STAGE_SEED );
     processQuery(refHash, RefFile, QueryFile, arrayTmpFile, revComplement, sw );
 
     delete [] refHash; 
@@ -417,18 +436,20 @@ bool is_numeric(const string &str)
 }
 
 
-int find_maximal_exact_matches( unsigned int l, unsigned char * ref, unsigned char * query, vector<QGramOcc> * q_grams, TSwitch sw )
+int find_maximal_exact_matches( unsigned int l, unsigned char * ref, unsigned char * query, vector<QGramOcc> * q_grams, TSwitch sw, SeqMasks * masks )
 {
 
     fprintf ( stderr, " -Identifying maximal exact matches of minimum length %i\n", l );
     
     int32_t i=0, n=1;
-    uint32_t options, revComplement=0;
+    uint32_t options=0, revComplement=0;
     seqFileReadInfo RefFile, QueryFile;
 
     
     RefFile.openFile( string(sw.output_filename)+"_new_ref.fa" );
     QueryFile.openFile( string(sw.output_filename)+"_new_query.fa" );
+    RefFile.setMask( &masks->ref );
+    QueryFile.setMask( &masks->query );
 
     commonData::minMemLen = 2* l;
     if( l % 2 == 0 )
@@ -450,7 +471,11 @@ int find_maximal_exact_matches( unsigned int l, unsigned char * ref, unsigned ch
     while (true)
     {
         for (i=0; i<commonData::d; i++) {
-            if(RefFile.readChunks()){
+            stats_stage( STAGE_INDEX );
+            double read = trace_now();
+            bool chunk = RefFile.readChunks();
+            trace_span( "read reference chunk", read, trace_now(), RefFile.totalBases );
+            if(chunk){
                 processReference(RefFile, QueryFile, arrayTmpFile, revComplement, sw);
                 RefFile.setCurrPos();
                 RefFile.clearMapForNs();
@@ -463,6 +488,7 @@ int find_maximal_exact_matches( unsigned int l, unsigned char * ref, unsigned ch
          * Process MemExt list 
          */ 
 
+        stats_stage( STAGE_DEDUP );
         arrayTmpFile.mergeMemExtVector(revComplement);
 
         if (revComplement)
@@ -501,6 +527,7 @@ int find_maximal_exact_matches( unsigned int l, unsigned char * ref, unsigned ch
     QueryFile.closeFile();
 
     arrayTmpFile.removeDuplicates(refSeqInfo, querySeqInfo, revComplement, q_grams, l);
+    stats_count( STAT_MEMS, q_grams->size() );
 
 
     return 0;
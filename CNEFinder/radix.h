@@ -0,0 +1,107 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef RADIX_H
+#define RADIX_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include <omp.h>
+
+#define RADIX_MIN_SIZE		4096
+#define RADIX_BITS		11
+#define RADIX_BUCKETS		( 1 << RADIX_BITS )
+
+using namespace std;
+
+/*
+Stable LSD radix sort of v by the 64-bit key(v[i]), RADIX_BITS bits per pass;
+digits that are the same in every key are skipped. Each pass is split across
+the OpenMP threads: every thread counts its own block, then scatters it to the
+offsets that the counts of all blocks give it. Short arrays are left to
+stable_sort(), which orders them the same way.
+*/
+template <class T, class Key>
+void radix_sort( vector<T> & v, Key key )
+{
+	size_t n = v.size();
+
+	if( n < RADIX_MIN_SIZE )
+	{
+		stable_sort( v.begin(), v.end(), [&key]( const T & a, const T & b ) { return key( a ) < key( b ); } );
+		return;
+	}
+
+	uint64_t all = ~( uint64_t ) 0;
+	uint64_t any = 0;
+	for( size_t i = 0; i < n; i++ )
+	{
+		uint64_t k = key( v[i] );
+		all &= k;
+		any |= k;
+	}
+
+	int threads = omp_get_max_threads();
+	vector<T> tmp( n );
+	vector<size_t> count( ( size_t ) threads * RADIX_BUCKETS );
+	T * src = v.data();
+	T * dst = tmp.data();
+
+	for( int shift = 0; shift < 64; shift += RADIX_BITS )
+	{
+		if( ( ( all ^ any ) >> shift & ( RADIX_BUCKETS - 1 ) ) == 0 )
+			continue;
+
+		#pragma omp parallel num_threads( threads )
+		{
+			int t = omp_get_thread_num();
+			int team = omp_get_num_threads();
+			size_t from = n * t / team;
+			size_t to = n * ( t + 1 ) / team;
+			size_t * c = &count[( size_t ) t * RADIX_BUCKETS];
+
+			fill( c, c + RADIX_BUCKETS, 0 );
+			for( size_t i = from; i < to; i++ )
+				c[key( src[i] ) >> shift & ( RADIX_BUCKETS - 1 )]++;
+
+			#pragma omp barrier
+			#pragma omp single
+			{
+				size_t sum = 0;
+				for( int d = 0; d < RADIX_BUCKETS; d++ )
+					for( int u = 0; u < team; u++ )
+					{
+						size_t x = count[( size_t ) u * RADIX_BUCKETS + d];
+						count[( size_t ) u * RADIX_BUCKETS + d] = sum;
+						sum += x;
+					}
+			}
+
+			for( size_t i = from; i < to; i++ )
+				dst[c[key( src[i] ) >> shift & ( RADIX_BUCKETS - 1 )]++] = src[i];
+		}
+
+		swap( src, dst );
+	}
+
+	if( src != v.data() )
+		copy( src, src + n, v.begin() );
+}
+
+#endif
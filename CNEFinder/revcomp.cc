@@ -0,0 +1,154 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+#include "cnef.h"
+
+using namespace std;
+
+/*
+A and T differ by 0x15 and C and G by 0x04 in either case, so a base is
+complemented by xor'ing it with a value looked up by its low four bits. Every
+other character, the mask symbol and N among them, is kept, so the reverse
+complement has the length of the sequence and masked runs stay where the
+coordinate mapping puts them.
+*/
+struct RcTable
+ {
+   unsigned char comp[256];
+
+   RcTable()
+   {
+	for( int c = 0; c < 256; c++ )
+		comp[c] = c;
+
+	const char * from = "ACGTacgt";
+	const char * to = "TGCAtgca";
+
+	for( int i = 0; i < 8; i++ )
+		comp[( unsigned char ) from[i]] = to[i];
+   }
+ };
+
+static const unsigned char * rc_table( void )
+{
+	static const RcTable t;
+
+return t . comp;
+}
+
+#ifdef __x86_64__
+__attribute__(( target( "ssse3" ) ))
+static inline __m128i rc_block( __m128i c )
+{
+	const __m128i reverse = _mm_set_epi8( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 );
+	const __m128i flip = _mm_setr_epi8( 0, 0x15, 0, 0x04, 0x15, 0, 0, 0x04, 0, 0, 0, 0, 0, 0, 0, 0 );
+	const __m128i upper = _mm_set1_epi8( ( char ) 0xDF );
+	__m128i u = _mm_and_si128( c, upper );
+	__m128i base = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( u, _mm_set1_epi8( 'A' ) ), _mm_cmpeq_epi8( u, _mm_set1_epi8( 'C' ) ) ),
+				     _mm_or_si128( _mm_cmpeq_epi8( u, _mm_set1_epi8( 'G' ) ), _mm_cmpeq_epi8( u, _mm_set1_epi8( 'T' ) ) ) );
+	__m128i x = _mm_shuffle_epi8( flip, _mm_and_si128( c, _mm_set1_epi8( 0x0F ) ) );
+
+	c = _mm_xor_si128( c, _mm_and_si128( x, base ) );
+
+return _mm_shuffle_epi8( c, reverse );
+}
+
+/*
+Sixteen bases from each end per step; both blocks are loaded before either is
+stored, so str2 may be str
+*/
+__attribute__(( target( "ssse3" ) ))
+static unsigned int rc_ssse3( unsigned char * str, unsigned char * str2, unsigned int len )
+{
+	unsigned int i = 0;
+	unsigned int j = len;
+
+	while( j - i >= 32 )
+	{
+		__m128i front = _mm_loadu_si128( ( __m128i * ) &str[i] );
+		__m128i back = _mm_loadu_si128( ( __m128i * ) &str[j - 16] );
+
+		_mm_storeu_si128( ( __m128i * ) &str2[i], rc_block( back ) );
+		_mm_storeu_si128( ( __m128i * ) &str2[j - 16], rc_block( front ) );
+		i += 16;
+		j -= 16;
+	}
+
+return i;
+}
+#endif
+
+/*
+Writes the reverse complement of str[0..len) to str2[0..len), which may be str
+itself; str2 is not terminated
+*/
+unsigned int rev_complement( unsigned char * str, unsigned char * str2, unsigned int len )
+{
+	const unsigned char * comp = rc_table();
+	unsigned int i = 0;
+
+#ifdef __x86_64__
+	static const bool ssse3 = __builtin_cpu_supports( "ssse3" );
+
+	if( ssse3 )
+		i = rc_ssse3( str, str2, len );
+#endif
+
+	unsigned int j = len - i;
+
+	while( i < j )
+	{
+		unsigned char front = str[i];
+		unsigned char back = str[j - 1];
+
+		str2[i++] = comp[back];
+		str2[--j] = comp[front];
+	}
+
+return 1;
+}
+
+/*
+Moves the half-open interval [*start, *end) of a sequence of length len to the
+same bases in its reverse complement, and back
+*/
+void rc_interval( unsigned int len, unsigned int * start, unsigned int * end )
+{
+	unsigned int s = *start;
+
+	*start = len - *end;
+	*end = len - s;
+}
+
+/*
+Moves the query coordinates of CNEs found against the reverse complement of a
+query region of length len back to the forward strand
+*/
+void rc_cnes( vector<MimOcc> * mims, unsigned int len )
+{
+	for( unsigned int i = 0; i < mims->size(); i++ )
+		rc_interval( len, &( *mims )[i] . startQuery, &( *mims )[i] . endQuery );
+}
@@ -0,0 +1,213 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "cnef.h"
+
+using namespace std;
+
+struct StageStats
+ {
+   double		wall;
+   double		cpu;
+   long			rss;
+ };
+
+static const char * stage_names[STAGES] = { "load", "masking", "index", "seeding", "mem_dedup", "merge", "extension", "adjust", "overlaps", "output" };
+static const char * counter_names[COUNTERS] = { "kmer_hits", "mems", "chains", "myers_calls", "dp_cells", "cnes" };
+
+/*
+Nothing is measured unless --stats or --trace is given; the stages run one after
+another in the main thread, so only the counters and stats_add() see other
+threads
+*/
+static bool stats_on = false;
+static int stats_current = STAGE_NONE;
+static StatsTime stats_began, stats_first;
+static double stats_traced;
+static StageStats stages[STAGES];
+static unsigned long long counters[COUNTERS];
+
+/*
+Wall time and the CPU time of all threads of the process so far
+*/
+static void stats_process( StatsTime * t, long * rss )
+{
+	struct rusage u;
+
+	getrusage( RUSAGE_SELF, &u );
+	t->wall = gettime();
+	t->cpu = u . ru_utime . tv_sec + u . ru_utime . tv_usec * 0.000001 + u . ru_stime . tv_sec + u . ru_stime . tv_usec * 0.000001;
+	*rss = u . ru_maxrss;
+}
+
+void stats_init( TSwitch sw )
+{
+	long rss;
+
+	stats_on = sw . stats_filename != NULL || sw . trace_filename != NULL;
+	if( stats_on )
+		stats_process( &stats_first, &rss );
+}
+
+/*
+Closes the stage that is running and starts stage, or only closes it for
+STAGE_NONE. A stage that runs several times adds up its times; its peak RSS is
+the high-water mark of the process when it last ended.
+*/
+void stats_stage( int stage )
+{
+	if( ! stats_on )
+		return;
+
+	StatsTime now;
+	long rss;
+
+	stats_process( &now, &rss );
+
+	if( stats_current != STAGE_NONE )
+	{
+		stages[stats_current] . wall += now . wall - stats_began . wall;
+		stages[stats_current] . cpu += now . cpu - stats_began . cpu;
+		stages[stats_current] . rss = rss;
+		trace_span( stage_names[stats_current], stats_traced, trace_now(), -1 );
+	}
+
+	stats_current = stage;
+	stats_began = now;
+	stats_traced = trace_now();
+}
+
+/*
+Wall time and the CPU time of the calling thread, for stages timed call by call
+inside a parallel loop
+*/
+void stats_now( StatsTime * t )
+{
+	if( ! stats_on )
+		return;
+
+	struct timespec c;
+
+	clock_gettime( CLOCK_THREAD_CPUTIME_ID, &c );
+	t->wall = gettime();
+	t->cpu = c . tv_sec + c . tv_nsec * 0.000000001;
+}
+
+/*
+Adds the time since since to sum
+*/
+void stats_lap( StatsTime * sum, StatsTime * since )
+{
+	if( ! stats_on )
+		return;
+
+	StatsTime now;
+
+	stats_now( &now );
+	sum->wall += now . wall - since->wall;
+	sum->cpu += now . cpu - since->cpu;
+}
+
+/*
+Adds the time one thread spent in stage; the times of all threads add up
+*/
+void stats_add( int stage, StatsTime * t )
+{
+	if( ! stats_on )
+		return;
+
+	#pragma omp critical( stats )
+	{
+		stages[stage] . wall += t->wall;
+		stages[stage] . cpu += t->cpu;
+	}
+}
+
+void stats_count( int counter, unsigned long long n )
+{
+	if( stats_on )
+		__atomic_fetch_add( &counters[counter], n, __ATOMIC_RELAXED );
+}
+
+/*
+Writes the report to the --stats file:
+
+	{
+	  "threads": T,
+	  "total": { "wall_s": .., "cpu_s": .., "peak_rss_kb": .. },
+	  "stages": { "load": { "wall_s": .., "cpu_s": .., "peak_rss_kb": .. }, .. },
+	  "counters": { "kmer_hits": .., .. }
+	}
+
+Times are in seconds. The times of adjust are summed over the threads and are
+also part of extension; its peak RSS is null as it is not a stage of its own.
+*/
+int stats_write( TSwitch sw )
+{
+	if( ! stats_on )
+		return 0;
+
+	FILE * out;
+	StatsTime now;
+	long rss;
+
+	stats_stage( STAGE_NONE );
+	stats_process( &now, &rss );
+
+	if( sw . stats_filename == NULL )
+		return 0;
+
+	if ( ! ( out = fopen ( sw . stats_filename, "w" ) ) )
+	{
+		fprintf ( stderr, " Error: Cannot open file %s!\n", sw . stats_filename );
+		return ( 1 );
+	}
+
+	fprintf( out, "{\n  \"threads\": %d,\n", sw . T );
+	fprintf( out, "  \"total\": { \"wall_s\": %.6f, \"cpu_s\": %.6f, \"peak_rss_kb\": %ld },\n", now . wall - stats_first . wall, now . cpu - stats_first . cpu, rss );
+
+	fprintf( out, "  \"stages\": {\n" );
+	for( int s = 0; s < STAGES; s++ )
+	{
+		fprintf( out, "    \"%s\": { \"wall_s\": %.6f, \"cpu_s\": %.6f, \"peak_rss_kb\": ", stage_names[s], stages[s] . wall, stages[s] . cpu );
+		if( s == STAGE_ADJUST )
+			fprintf( out, "null" );
+		else
+			fprintf( out, "%ld", stages[s] . rss );
+		fprintf( out, " }%s\n", s + 1 < STAGES ? "," : "" );
+	}
+	fprintf( out, "  },\n" );
+
+	fprintf( out, "  \"counters\": {\n" );
+	for( int c = 0; c < COUNTERS; c++ )
+		fprintf( out, "    \"%s\": %llu%s\n", counter_names[c], counters[c], c + 1 < COUNTERS ? "," : "" );
+	fprintf( out, "  }\n}\n" );
+
+	if ( fclose ( out ) )
+	{
+		fprintf( stderr, " Error: file close error!\n");
+		return ( 1 );
+	}
+
+return 0;
+}
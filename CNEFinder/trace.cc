@@ -0,0 +1,181 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include <omp.h>
+#include "cnef.h"
+
+using namespace std;
+
+#define TRACE_RING		( 1 << 16 )
+#define TRACE_LONG		1000.0
+
+struct TraceEvent
+ {
+   const char		* name;
+   double		begin;
+   double		end;
+   long long		arg;
+ };
+
+/*
+One ring of events per OpenMP thread, on its own cache lines; when a ring is
+full the oldest events are overwritten and counted as dropped
+*/
+struct TraceRing
+ {
+   vector<TraceEvent>	events;
+   unsigned long long	next;
+   char			pad[64];
+ };
+
+static bool trace_on = false;
+static double trace_epoch;
+static vector<TraceRing> trace_rings;
+
+static double trace_clock( void )
+{
+	struct timespec c;
+
+	clock_gettime( CLOCK_MONOTONIC, &c );
+
+return c . tv_sec * 1000000.0 + c . tv_nsec * 0.001;
+}
+
+void trace_init( TSwitch sw )
+{
+	trace_on = sw . trace_filename != NULL;
+	if( ! trace_on )
+		return;
+
+	trace_rings . resize( max( omp_get_max_threads(), sw . T ) );
+	for( unsigned int t = 0; t < trace_rings . size(); t++ )
+	{
+		trace_rings[t] . events . resize( TRACE_RING );
+		trace_rings[t] . next = 0;
+	}
+	trace_epoch = trace_clock();
+}
+
+/*
+Microseconds since trace_init(), or 0 when not tracing
+*/
+double trace_now( void )
+{
+	if( ! trace_on )
+		return 0;
+
+return trace_clock() - trace_epoch;
+}
+
+/*
+Records the span of name from begin to end on the calling thread; arg is shown
+with the span when it is not negative
+*/
+void trace_span( const char * name, double begin, double end, long long arg )
+{
+	if( ! trace_on )
+		return;
+
+	unsigned int t = omp_get_thread_num();
+
+	if( t >= trace_rings . size() )
+		return;
+
+	TraceRing * r = &trace_rings[t];
+	TraceEvent * e = &r->events[r->next++ % TRACE_RING];
+
+	e->name = name;
+	e->begin = begin;
+	e->end = end;
+	e->arg = arg;
+}
+
+/*
+As trace_span() up to now, for spans that happen too often to keep unless they
+are long
+*/
+void trace_long( const char * name, double begin, long long arg )
+{
+	if( ! trace_on )
+		return;
+
+	double end = trace_now();
+
+	if( end - begin >= TRACE_LONG )
+		trace_span( name, begin, end, arg );
+}
+
+/*
+Writes the Chrome trace event file given with --trace; it opens in
+chrome://tracing and in the Perfetto UI. Spans are complete ("X") events in
+microseconds, one track per OpenMP thread.
+*/
+int trace_write( TSwitch sw )
+{
+	if( ! trace_on )
+		return 0;
+
+	FILE * out;
+	unsigned long long dropped = 0;
+	bool first = true;
+
+	if ( ! ( out = fopen ( sw . trace_filename, "w" ) ) )
+	{
+		fprintf ( stderr, " Error: Cannot open file %s!\n", sw . trace_filename );
+		return ( 1 );
+	}
+
+	fprintf( out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+
+	for( unsigned int t = 0; t < trace_rings . size(); t++ )
+	{
+		TraceRing * r = &trace_rings[t];
+		unsigned long long from = r->next > TRACE_RING ? r->next - TRACE_RING : 0;
+
+		if( r->next == 0 )
+			continue;
+
+		dropped += from;
+		fprintf( out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}", first ? "" : ",\n", t, t );
+		first = false;
+
+		for( unsigned long long i = from; i < r->next; i++ )
+		{
+			TraceEvent * e = &r->events[i % TRACE_RING];
+
+			fprintf( out, ",\n{\"name\":\"%s\",\"cat\":\"cnef\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", e->name, t, e->begin, e->end - e->begin );
+			if( e->arg >= 0 )
+				fprintf( out, ",\"args\":{\"n\":%lld}", e->arg );
+			fprintf( out, "}" );
+		}
+	}
+
+	fprintf( out, "\n],\"otherData\":{\"dropped_events\":%llu}}\n", dropped );
+
+	if ( fclose ( out ) )
+	{
+		fprintf( stderr, " Error: file close error!\n");
+		return ( 1 );
+	}
+
+return 0;
+}
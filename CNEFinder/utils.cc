@@ -56,6 +56,11 @@ static struct option long_options[] =
    { "repeat-regions",			optional_argument, NULL, 'p' },
    { "merged-length",			optional_argument, NULL, 'M' },
    { "mem-length",			optional_argument, NULL, 'Q' },
+   { "ext-mode",			required_argument, NULL, 'E' },
+   { "out-format",			required_argument, NULL, 'O' },
+   { "index-annotations",		required_argument, NULL, 'i' },
+   { "stats",				required_argument, NULL, 'S' },
+   { "trace",				required_argument, NULL, 'P' },
    { "help",                    	no_argument,       NULL, 'h' },
    { NULL,                      	0,                 NULL,  0  }
  };
@@ -90,6 +95,8 @@ int decode_switches ( int argc, char * argv [], struct TSwitch * sw )
    sw -> query_exons_filename		= NULL;
    sw -> ref_chrom			= NULL;
    sw -> query_chrom			= NULL;
+   sw -> stats_filename			= NULL;
+   sw -> trace_filename			= NULL;
    sw -> a				= 0;
    sw -> b				= 0;
    sw -> c				= 0;
@@ -98,9 +105,12 @@ int decode_switches ( int argc, char * argv [], struct TSwitch * sw )
    sw -> T                              = 1;
    sw -> M				= 0.5;
    sw -> Q				= 18;
+   sw -> E				= EXT_GREEDY;
+   sw -> O				= OUT_TEXT;
+   sw -> i				= 0;
    args = 0;
 
-   while ( ( opt = getopt_long ( argc, argv, "q:r:o:e:f:g:j:x:n:m:l:u:t:s:v:a:b:c:d:y:z:p:T:M:Q:h", long_options, &oi ) ) != -1 ) 
+   while ( ( opt = getopt_long ( argc, argv, "q:r:o:e:f:g:j:x:n:m:l:u:t:s:v:a:b:c:d:y:z:p:T:M:Q:E:O:i:S:P:h", long_options, &oi ) ) != -1 ) 
     {
 
       switch ( opt )
@@ -200,6 +210,25 @@ int decode_switches ( int argc, char * argv [], struct TSwitch * sw )
            sw -> x = val;
            break;
 
+	  case 'i':
+           val = strtol ( optarg, &ep, 10 );
+           if ( optarg == ep )
+            {
+              return ( 0 );
+            }
+           sw -> i = val;
+           break;
+
+	 case 'S':
+           sw -> stats_filename = ( char * ) malloc ( ( strlen ( optarg ) + 1 ) * sizeof ( char ) );
+           strcpy ( sw -> stats_filename, optarg );
+           break;
+
+	 case 'P':
+           sw -> trace_filename = ( char * ) malloc ( ( strlen ( optarg ) + 1 ) * sizeof ( char ) );
+           strcpy ( sw -> trace_filename, optarg );
+           break;
+
 	case 't':
            val = atof( optarg );
            if ( optarg == ep )
@@ -303,6 +332,30 @@ int decode_switches ( int argc, char * argv [], struct TSwitch * sw )
            sw -> Q = val;
            break;
 
+	 case 'E':
+           if ( strcmp ( optarg, "greedy" ) == 0 )
+             sw -> E = EXT_GREEDY;
+           else if ( strcmp ( optarg, "xdrop" ) == 0 )
+             sw -> E = EXT_XDROP;
+           else if ( strcmp ( optarg, "wfa" ) == 0 )
+             sw -> E = EXT_WFA;
+           else
+            {
+              return ( 0 );
+            }
+           break;
+
+	 case 'O':
+           if ( strcmp ( optarg, "text" ) == 0 )
+             sw -> O = OUT_TEXT;
+           else if ( strcmp ( optarg, "bin" ) == 0 )
+             sw -> O = OUT_BIN;
+           else
+            {
+              return ( 0 );
+            }
+           break;
+
          case 'h':
            return ( 0 );
        }
@@ -353,8 +406,13 @@ void usage ( void )
    fprintf ( stdout, "  -M, --merged-length		<dbl>		Minimum length (in terms of CNE length) of merged matches to be extended. Default:0.5.\n" );
    fprintf ( stdout, "  -s, --ext-threshold		<dbl>		Threshold to further extend similarity threshold by. Default:0.05.\n" );
    fprintf ( stdout, "  -u, --max-seq-length		<int>		Set a maximum length for the CNE. Default:2000.\n" ); 
+   fprintf ( stdout, "  -E, --ext-mode		<str>		Extension engine: greedy, xdrop or wfa. Default:greedy.\n" );
+   fprintf ( stdout, "  -O, --out-format		<str>		Output format: text, or bin for fixed-width binary records. Default:text.\n" );
    fprintf ( stdout, "  -p, --repeat-regions		<int>		Choose 1 to filter repetitive regions of genomes or 0 otherwise. Default:1.\n");	
-   fprintf ( stdout, "  -v, --rev-complement		<int>		Choose 1 to compute CNEs for reverse complement or 0 otherwise. Default:0.\n");						
+   fprintf ( stdout, "  -v, --rev-complement		<int>		Choose 1 to compute CNEs against the reverse complement of the query region or 0 otherwise; query coordinates are given on the forward strand. Default:0.\n");						
+   fprintf ( stdout, "  -i, --index-annotations	<int>		Choose 1 to save the parsed exon and gene files to index files next to them and reuse these, or 0 otherwise. Default:0.\n" );
+   fprintf ( stdout, "  -S, --stats			<str>		Write the time, CPU time and peak memory of each stage and the work counters to this JSON file.\n" );
+   fprintf ( stdout, "  -P, --trace			<str>		Write a timeline of the stages and of the work of each thread to this Chrome trace file.\n" );
    fprintf ( stdout, "  -x, --remove-overlaps		<int>		Choose 1 to remove overlapping CNEs or 0 otherwise. Default:1.\n\n" );  
 
    fprintf ( stdout, " Number of threads:\n" ); 
@@ -0,0 +1,210 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "cnef.h"
+
+using namespace std;
+
+#define WFA_NONE	( -( 1 << 29 ) )
+
+/*
+Length of the run of matches between a from i and b from j, compared eight
+bytes at a time
+*/
+static inline int wfa_lce( unsigned char * a, int i, int n, unsigned char * b, int j, int m )
+{
+	int l = 0;
+	int lim = min( n - i, m - j );
+
+	while( l + 8 <= lim )
+	{
+		uint64_t u, v;
+
+		memcpy( &u, &a[i+l], 8 );
+		memcpy( &v, &b[j+l], 8 );
+		if( u != v )
+			return l + ( __builtin_ctzll( u ^ v ) >> 3 );
+		l += 8;
+	}
+
+	while( l < lim && a[i+l] == b[j+l] )
+		l++;
+
+	return l;
+}
+
+/*
+Furthest offset reachable on diagonal k = i - j with one more edit than the
+wavefront cur, which covers diagonals lo to hi and is indexed by k + off
+*/
+static inline int wfa_next( int * cur, int lo, int hi, int off, int k, int n, int m )
+{
+	int i = WFA_NONE;
+
+	if( k >= lo && k <= hi && cur[k+off] != WFA_NONE )
+	{
+		int p = cur[k+off];
+
+		i = p;
+		if( p < n && p - k < m )
+			i = p + 1;
+	}
+
+	if( k - 1 >= lo && k - 1 <= hi && cur[k-1+off] != WFA_NONE && cur[k-1+off] < n )
+		i = max( i, cur[k-1+off] + 1 );
+
+	if( k + 1 >= lo && k + 1 <= hi && cur[k+1+off] != WFA_NONE && cur[k+1+off] - k - 1 < m )
+		i = max( i, cur[k+1+off] );
+
+	return i;
+}
+
+/*
+Wavefront edit distance of the whole of xInput against the whole of yInput;
+gives the same value as editDistanceMyers() in O((n+m)s) time for distance s
+*/
+int editDistanceWFA( unsigned char * xInput, unsigned char * yInput, Workspace * ws )
+{
+	int n = strlen( ( char* ) xInput );
+	int m = strlen( ( char* ) yInput );
+
+	if( n == 0 || m == 0 )
+		return max( n, m );
+
+	size_t mark = ws->used;
+	int * cur = ( int * ) ws_calloc( ws, ( n + m + 1 ) * sizeof( int ) );
+	int * nxt = ( int * ) ws_calloc( ws, ( n + m + 1 ) * sizeof( int ) );
+	for( int k = 0; k < n + m + 1; k++ )
+		cur[k] = nxt[k] = WFA_NONE;
+
+	int target = n - m;
+
+	cur[m] = wfa_lce( xInput, 0, n, yInput, 0, m );
+	if( target == 0 && cur[m] >= n )
+	{
+		ws->used = mark;
+		return 0;
+	}
+
+	int lo = 0;
+	int hi = 0;
+	for( int s = 1; ; s++ )
+	{
+		int nlo = max( lo - 1, -m );
+		int nhi = min( hi + 1, n );
+
+		for( int k = nlo; k <= nhi; k++ )
+		{
+			int i = wfa_next( cur, lo, hi, m, k, n, m );
+
+			if( i != WFA_NONE )
+				i += wfa_lce( xInput, i, n, yInput, i - k, m );
+
+			nxt[k+m] = i;
+		}
+
+		if( target >= nlo && target <= nhi && nxt[target+m] >= n )
+		{
+			ws->used = mark;
+			return s;
+		}
+
+		int * t = cur;
+		cur = nxt;
+		nxt = t;
+		lo = nlo;
+		hi = nhi;
+	}
+}
+
+/*
+End-free wavefront extension of one side of a match. Diagonals whose furthest
+point (i,j) scores limit * (i+j)/2 - s more than X below the best point seen
+are dropped. prof receives, for every error count s, the furthest point ending
+on a match that is reachable with at most s errors.
+*/
+int wfa_extend_side( unsigned char * a, int nA, unsigned char * b, int nB, double limit, double X, ExtProfile * prof, Workspace * ws )
+{
+	int * cur = ( int * ) ws_calloc( ws, ( nA + nB + 1 ) * sizeof( int ) );
+	int * nxt = ( int * ) ws_calloc( ws, ( nA + nB + 1 ) * sizeof( int ) );
+	for( int k = 0; k < nA + nB + 1; k++ )
+		cur[k] = nxt[k] = WFA_NONE;
+
+	int off = nB;
+
+	prof->ref.assign( 1, 0 );
+	prof->query.assign( 1, 0 );
+
+	int l = wfa_lce( a, 0, nA, b, 0, nB );
+	cur[off] = l;
+	if( l > 0 )
+		ext_profile_add( prof, 0, l, l );
+
+	double best = limit * l;
+	int lo = 0;
+	int hi = 0;
+	for( int s = 1; lo <= hi; s++ )
+	{
+		int nlo = max( lo - 1, -nB );
+		int nhi = min( hi + 1, nA );
+
+		for( int k = nlo; k <= nhi; k++ )
+		{
+			int i = wfa_next( cur, lo, hi, off, k, nA, nB );
+
+			if( i != WFA_NONE )
+			{
+				int e = wfa_lce( a, i, nA, b, i - k, nB );
+
+				if( e > 0 )
+					ext_profile_add( prof, s, i + e, i + e - k );
+
+				i += e;
+				if( limit * ( 2 * i - k ) / 2.0 - s > best )
+					best = limit * ( 2 * i - k ) / 2.0 - s;
+			}
+
+			nxt[k+off] = i;
+		}
+
+		for( int k = nlo; k <= nhi; k++ )
+			if( nxt[k+off] != WFA_NONE && limit * ( 2 * nxt[k+off] - k ) / 2.0 - s < best - X )
+				nxt[k+off] = WFA_NONE;
+
+		while( nlo <= nhi && nxt[nlo+off] == WFA_NONE )
+			nlo++;
+		while( nhi >= nlo && nxt[nhi+off] == WFA_NONE )
+			nhi--;
+
+		int * t = cur;
+		cur = nxt;
+		nxt = t;
+		lo = nlo;
+		hi = nhi;
+	}
+
+	ext_profile_monotone( prof );
+
+return 0;
+}
@@ -0,0 +1,112 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "cnef.h"
+#include "edlib.h"
+
+using namespace std;
+
+#define WS_INITIAL_SIZE		( 1 << 16 )
+
+/*
+Per-thread scratch memory of the extension stage. Buffers are handed out from a
+bump arena and given back by rewinding ws->used to a mark taken before them;
+requests that do not fit are served by malloc and the arena is grown to fit
+them at the next ws_reset().
+*/
+void ws_init( Workspace * ws )
+{
+	ws->size = WS_INITIAL_SIZE;
+	ws->buf = ( unsigned char * ) malloc ( ws->size );
+	ws->used = 0;
+	ws->need = 0;
+	ws->edlib = edlibNewBuffers();
+
+	if( ws->buf == NULL )
+	{
+		fprintf( stderr, " Error: workspace could not be allocated!\n" );
+		exit( 1 );
+	}
+}
+
+void * ws_calloc( Workspace * ws, size_t n )
+{
+	unsigned char * p;
+
+	n = ( n + 15 ) & ~( ( size_t ) 15 );
+
+	if( ws->used + n <= ws->size )
+	{
+		p = ws->buf + ws->used;
+		ws->used += n;
+	}
+	else
+	{
+		p = ( unsigned char * ) malloc ( n );
+		if( p == NULL )
+		{
+			fprintf( stderr, " Error: workspace could not be allocated!\n" );
+			exit( 1 );
+		}
+		ws->spill.push_back( p );
+		ws->need = max( ws->need, ws->used ) + n;
+	}
+
+	memset( p, 0, n );
+
+return p;
+}
+
+void ws_reset( Workspace * ws )
+{
+	for( unsigned int i = 0; i < ws->spill.size(); i++ )
+		free( ws->spill[i] );
+	ws->spill.clear();
+
+	if( ws->need > ws->size )
+	{
+		while( ws->size < ws->need )
+			ws->size *= 2;
+
+		free( ws->buf );
+		ws->buf = ( unsigned char * ) malloc ( ws->size );
+		if( ws->buf == NULL )
+		{
+			fprintf( stderr, " Error: workspace could not be allocated!\n" );
+			exit( 1 );
+		}
+	}
+
+	ws->used = 0;
+	ws->need = 0;
+}
+
+void ws_free( Workspace * ws )
+{
+	for( unsigned int i = 0; i < ws->spill.size(); i++ )
+		free( ws->spill[i] );
+	ws->spill.clear();
+
+	free( ws->buf );
+	edlibFreeBuffers( ws->edlib );
+}
@@ -0,0 +1,155 @@
+/**
+    CNEFinder
+    Copyright (C) 2017 Lorraine A. K. Ayad, Solon P. Pissis, Dimitris Polychronopoulos
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+#include "cnef.h"
+
+using namespace std;
+
+#define XD_INF		( 1 << 29 )
+
+/*
+Banded X-drop edit distance DP of one side of a match, computed by
+antidiagonals. Cell (i,j) aligns i reference bases against j query bases and is
+dropped once limit * (i+j)/2 - D[i][j] falls more than X below the best value
+seen so far. prof receives, for every error count e, the furthest cell ending on
+a match whose distance is at most e.
+*/
+int xdrop_extend_side( unsigned char * a, int nA, unsigned char * b, int nB, double limit, double X, ExtProfile * prof, Workspace * ws )
+{
+	/* Query is stored reversed so that b[d-i-1] is read left to right along an antidiagonal */
+	unsigned char * brev = ( unsigned char * ) ws_calloc( ws, nB + 16 );
+	for( int k = 0; k < nB; k++ )
+		brev[k] = b[nB - 1 - k];
+
+	int * prev2 = ( int * ) ws_calloc( ws, ( nA + 2 ) * sizeof( int ) );
+	int * prev1 = ( int * ) ws_calloc( ws, ( nA + 2 ) * sizeof( int ) );
+	int * cur = ( int * ) ws_calloc( ws, ( nA + 2 ) * sizeof( int ) );
+	for( int i = 0; i < nA + 2; i++ )
+		prev2[i] = prev1[i] = cur[i] = XD_INF;
+
+	prof->ref.assign( 1, 0 );
+	prof->query.assign( 1, 0 );
+
+	prev1[0] = 0;
+	int lo = 0;
+	int hi = 0;
+	double best = 0;
+
+	for( int d = 1; d <= nA + nB; d++ )
+	{
+		int nlo = max( lo, d - nB );
+		int nhi = min( hi + 1, nA );
+
+		if( nlo > nhi )
+			break;
+
+		double lim = limit * d / 2.0 - best + X;
+		int cap = ( lim >= XD_INF ) ? XD_INF - 1 : ( int ) floor( lim );
+
+		int i = nlo;
+		if( i == 0 )
+		{
+			cur[0] = ( d <= cap ) ? d : XD_INF;
+			i++;
+		}
+
+		int iEnd = min( nhi, d - 1 );
+#ifdef __SSE4_1__
+		__m128i one = _mm_set1_epi32( 1 );
+		__m128i inf = _mm_set1_epi32( XD_INF );
+		__m128i vcap = _mm_set1_epi32( cap );
+		for( ; i + 3 <= iEnd; i += 4 )
+		{
+			__m128i ca = _mm_cvtepu8_epi32( _mm_cvtsi32_si128( *( int * ) &a[i-1] ) );
+			__m128i cb = _mm_cvtepu8_epi32( _mm_cvtsi32_si128( *( int * ) &brev[nB - d + i] ) );
+			__m128i sub = _mm_add_epi32( _mm_loadu_si128( ( __m128i * ) &prev2[i-1] ), _mm_add_epi32( one, _mm_cmpeq_epi32( ca, cb ) ) );
+			__m128i gap = _mm_add_epi32( _mm_min_epi32( _mm_loadu_si128( ( __m128i * ) &prev1[i-1] ), _mm_loadu_si128( ( __m128i * ) &prev1[i] ) ), one );
+			__m128i val = _mm_min_epi32( sub, gap );
+
+			val = _mm_blendv_epi8( val, inf, _mm_cmpgt_epi32( val, vcap ) );
+			_mm_storeu_si128( ( __m128i * ) &cur[i], val );
+		}
+#endif
+		for( ; i <= iEnd; i++ )
+		{
+			int val = prev2[i-1] + ( a[i-1] != brev[nB - d + i] );
+
+			if( prev1[i-1] + 1 < val )
+				val = prev1[i-1] + 1;
+			if( prev1[i] + 1 < val )
+				val = prev1[i] + 1;
+
+			cur[i] = ( val <= cap ) ? val : XD_INF;
+		}
+
+		if( nhi == d )
+			cur[d] = ( d <= cap ) ? d : XD_INF;
+
+		/* Trim the band to the surviving cells and record the match-ending ones */
+		while( nlo <= nhi && cur[nlo] >= XD_INF )
+			nlo++;
+		while( nhi >= nlo && cur[nhi] >= XD_INF )
+			nhi--;
+
+		if( nlo > nhi )
+			break;
+
+		int minD = XD_INF;
+		for( i = nlo; i <= nhi; i++ )
+		{
+			int D = cur[i];
+			int j = d - i;
+
+			if( D >= XD_INF )
+				continue;
+
+			if( D < minD )
+				minD = D;
+
+			if( i > 0 && j > 0 && D == prev2[i-1] && a[i-1] == b[j-1] )
+				ext_profile_add( prof, D, i, j );
+		}
+
+		if( limit * d / 2.0 - minD > best )
+			best = limit * d / 2.0 - minD;
+
+		if( nlo > 0 )
+			cur[nlo-1] = XD_INF;
+		if( nhi < nA )
+			cur[nhi+1] = XD_INF;
+
+		int * t = prev2;
+		prev2 = prev1;
+		prev1 = cur;
+		cur = t;
+		lo = nlo;
+		hi = nhi;
+	}
+
+	ext_profile_monotone( prof );
+
+return 0;
+}